@@ -0,0 +1,30 @@
+#pragma once
+
+#include "exmu.h"
+
+#define CHECK_SEED 0x2545F491
+#define CHECK_ARENA_SIZE (4 << 20)
+#define CHECK_PATH_DIMENSION 48
+#define CHECK_PATH_QUERIES 2000
+#define CHECK_PATH_WALLS 25
+#define CHECK_FLOW_DIMENSION 64
+#define CHECK_FLOW_TICKS 1000
+#define CHECK_FLOW_WALLS 10
+#define CHECK_FLOW_DOORS 3
+#define CHECK_STREAM_PATH "check_stream.tmp"
+#define CHECK_STREAM_CHUNK 64
+#define CHECK_STREAM_CHUNKS 8
+#define CHECK_STREAM_WAIT 2000
+#define CHECK_SNAPSHOT_DIMENSION 64
+#define CHECK_SNAPSHOT_ENTITIES 512
+#define CHECK_SNAPSHOT_TICKS 1000
+#define CHECK_SNAPSHOT_CHANGES 24
+#define CHECK_SNAPSHOT_DROP 10
+#define CHECK_SNAPSHOT_DELAY 20
+#define CHECK_SNAPSHOT_HELD 16
+#define CHECK_SNAPSHOT_SETTLE 100
+#define CHECK_SNAPSHOT_QUIET 16
+#define CHECK_SNAPSHOT_RADIUS 16
+
+// compares the fast paths against plain reference implementations on random maps and edits, run with --check
+int check_run(EXMU *state);
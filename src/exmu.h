@@ -6,6 +6,21 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <atomic>
+
+#ifndef EX_PROFILE
+#define EX_PROFILE 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <time.h>
+#endif
 
 enum {
     EX_FALSE = 0,
@@ -14,11 +29,60 @@ enum {
     EX_MAX_TEXT = 256,
     EX_MAX_ERROR = 1024,
     EX_MAX_WARN = 1024,
+    EX_MAX_GAMEPADS = 4,
+    EX_MAX_PROFILE_THREADS = 64,
+    EX_MAX_PROFILE_EVENTS = 1 << 16,
+    EX_MAX_PROFILE_FRAMES = 256,
+    EX_COUNTER_CYCLES = 0,
+    EX_COUNTER_INSTRUCTIONS = 1,
+    EX_COUNTER_CACHE_MISSES = 2,
+    EX_COUNTER_BRANCH_MISSES = 3,
+    EX_MAX_COUNTERS = 4,
+    EX_MAX_FRAME_STATS = 256,
+    EX_MAX_FRAME_HISTOGRAM = 32,
+    EX_MAX_REPLAY_HISTOGRAM = 1000,
+    EX_REPLAY_NONE = 0,
+    EX_REPLAY_RECORD = 1,
+    EX_REPLAY_PLAYBACK = 2,
+    EX_MAX_PIXEL_BUFFERS = 3,
+    EX_MAX_CAPTURE_SLOTS = 8,
+    EX_MAX_CAPTURE_PATH = 256,
+    EX_CAPTURE_NONE = 0,
+    EX_CAPTURE_PPM = 1,
+    EX_CAPTURE_QOI = 2,
+    EX_MAX_PACKET_SIZE = 1400,
+    EX_MAX_LOOPBACK_PACKETS = 64,
+    EX_TRANSPORT_NONE = 0,
+    EX_TRANSPORT_LOOPBACK = 1,
+    EX_TRANSPORT_UDP = 2,
+    EX_MAX_MODULE_PATH = 256,
+    EX_MAX_STREAM_REQUESTS = 256,
+    EX_MAX_STREAM_SLOTS = 64,
+    EX_MAX_STREAM_THREADS = 8,
+    EX_MAX_STREAM_PATH = 256,
+    EX_STREAM_FREE = 0,
+    EX_STREAM_LOADING = 1,
+    EX_STREAM_LOADED = 2,
+    EX_STREAM_FAILED = 3,
+    EX_STREAM_READY = 4,
     EX_KEY_CONTROL = 0x11,
     EX_KEY_ESCAPE = 0x1B,
+    EX_KEY_F1 = 0x70,
+    EX_KEY_F2 = 0x71,
+    EX_KEY_F3 = 0x72,
+    EX_KEY_F4 = 0x73,
+    EX_KEY_F5 = 0x74,
+    EX_KEY_F6 = 0x75,
+    EX_KEY_F7 = 0x76,
+    EX_KEY_F8 = 0x77,
+    EX_KEY_F9 = 0x78,
+    EX_KEY_F10 = 0x79,
+    EX_KEY_F11 = 0x7A,
+    EX_KEY_F12 = 0x7B,
 };
 
 typedef uint8_t EXBOOL;
+typedef void EXTHREADPROC(void *data);
 
 struct EXINT2 {
     int x;
@@ -100,10 +164,204 @@ struct EXTIME {
     uint64_t microseconds;
     uint64_t milliseconds;
 
+    uint64_t wall_ticks;
+    uint64_t wall_delta_nanoseconds;
+    uint64_t work_nanoseconds;
+
     uint64_t initial_ticks;
     uint64_t ticks_per_second;
 };
     
+struct EXFRAMESTATS {
+    uint64_t count;
+    uint64_t deltas[EX_MAX_FRAME_STATS];
+    uint64_t total;
+
+    uint64_t min;
+    uint64_t max;
+    uint64_t average;
+    uint64_t p95;
+    uint64_t p99;
+
+    uint64_t histogram_bucket;
+    uint32_t histogram[EX_MAX_FRAME_HISTOGRAM];
+};
+
+struct EXPROFILE {
+    uint64_t frame_count;
+    uint64_t frame_ticks[EX_MAX_PROFILE_FRAMES];
+    uint64_t calibration_ticks;
+    uint64_t calibration_time_ticks;
+    double ticks_per_second;
+};
+
+// mask has a bit set for each counter the current thread could open
+struct EXCOUNTERS {
+    uint32_t mask;
+    uint64_t values[EX_MAX_COUNTERS];
+};
+
+struct EXREPLAYGAMEPAD {
+    EXBOOL connected;
+    uint16_t buttons;
+    uint8_t triggers[2];
+    int16_t sticks[4];
+};
+
+struct EXREPLAYFRAME {
+    uint64_t delta_ticks;
+    uint8_t keys[EX_MAX_KEYS / 8];
+    EXREPLAYGAMEPAD gamepads[EX_MAX_GAMEPADS];
+    EXINT2 mouse_position;
+    EXINT2 mouse_delta_position;
+    int mouse_delta_wheel;
+    uint8_t mouse_buttons;
+    uint32_t text_length;
+    char text[EX_MAX_TEXT];
+};
+
+struct EXREPLAY {
+    int mode;
+    FILE *file;
+    uint64_t frame_count;
+    uint64_t ticks_per_second;
+    EXREPLAYFRAME frame;
+    EXREPLAYFRAME previous_frame;
+
+    uint64_t wall_nanoseconds;
+    uint64_t wall_max_nanoseconds;
+    uint32_t wall_histogram[EX_MAX_REPLAY_HISTOGRAM];
+};
+
+// indices are column-major (column * height + row), pixels are row-major
+struct EXFRAMEBUFFER {
+    uint8_t *indices;
+    uint8_t *transposed;
+    uint32_t *pixels;
+    uint32_t palette[256];
+    int width;
+    int height;
+    int capacity;
+};
+
+struct EXARENA {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+};
+
+struct EXMODULE {
+    char path[EX_MAX_MODULE_PATH];
+    void *library;
+    uint64_t write_time;
+    int version;
+};
+
+// host and port in host byte order
+struct EXADDRESS {
+    uint32_t host;
+    uint16_t port;
+};
+
+struct EXPACKET {
+    EXADDRESS address;
+    int size;
+    uint8_t data[EX_MAX_PACKET_SIZE];
+};
+
+struct EXLOOPBACKQUEUE {
+    uint32_t head;
+    uint32_t tail;
+    EXPACKET packets[EX_MAX_LOOPBACK_PACKETS];
+};
+
+// an in-process pair of queues shared by two transports on the same thread
+struct EXLOOPBACK {
+    int references;
+    EXLOOPBACKQUEUE queues[2];
+};
+
+struct EXTRANSPORT {
+    int type;
+    EXADDRESS address;
+    uintptr_t socket;
+    EXLOOPBACK *loopback;
+    int loopback_side;
+
+    uint64_t packets_sent;
+    uint64_t packets_received;
+    uint64_t packets_dropped;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+};
+
+struct EXCAPTURESLOT {
+    EXFRAMEBUFFER framebuffer;
+    int format;
+    char path[EX_MAX_CAPTURE_PATH];
+};
+
+struct EXCAPTURE {
+    int format;
+    EXBOOL screenshot;
+    EXBOOL sequence;
+    char sequence_prefix[EX_MAX_CAPTURE_PATH];
+    uint64_t sequence_frame;
+    uint64_t screenshot_count;
+    uint64_t captured;
+    uint64_t dropped;
+    void *thread;
+    void *free_semaphore;
+    void *filled_semaphore;
+    uint32_t head;
+    uint32_t tail;
+    EXCAPTURESLOT slots[EX_MAX_CAPTURE_SLOTS];
+};
+
+struct EXSTREAMREQUEST {
+    uint64_t key;
+    char path[EX_MAX_STREAM_PATH];
+    uint64_t offset;
+    uint32_t size;
+    EXFLOAT2 position;
+    float distance;
+};
+
+// a loading slot belongs to its worker until the state says otherwise, every other state is the main thread's
+struct EXSTREAMSLOT {
+    std::atomic<int> state;
+    EXBOOL released;
+    uint8_t *data;
+    uint32_t size;
+    uint64_t frame;
+    EXSTREAMREQUEST request;
+};
+
+struct EXSTREAM {
+    EXFLOAT2 camera;
+    int slot_count;
+    uint32_t slot_capacity;
+    uint8_t *memory;
+    EXSTREAMSLOT slots[EX_MAX_STREAM_SLOTS];
+    EXSTREAMREQUEST requests[EX_MAX_STREAM_REQUESTS];
+    int request_count;
+
+    int thread_count;
+    void *threads[EX_MAX_STREAM_THREADS];
+    void *job_semaphore;
+    int jobs[EX_MAX_STREAM_SLOTS];
+    uint32_t job_head;
+    std::atomic<uint32_t> job_tail;
+    EXBOOL quit;
+
+    uint64_t frame;
+    uint64_t requested;
+    uint64_t loaded;
+    uint64_t failed;
+    uint64_t evicted;
+    uint64_t bytes;
+};
+
 struct EXWINDOW {
     const char *title;
     EXINT2 position;
@@ -122,6 +380,15 @@ typedef struct _XINPUT_VIBRATION XINPUT_VIBRATION;
 typedef X_INPUT_GET_STATE(XINPUTGETSTATE);
 typedef X_INPUT_SET_STATE(XINPUTSETSTATE);
 
+struct EXWIN32GAMEPAD {
+    unsigned long packet_number;
+    uint64_t next_poll_ticks;
+    uint64_t poll_interval_ticks;
+    uint16_t left_motor_speed;
+    uint16_t right_motor_speed;
+    EXBOOL vibration_written;
+};
+
 struct EXWIN32 {
     HANDLE window;
     HANDLE device_context;
@@ -131,21 +398,40 @@ struct EXWIN32 {
     
     XINPUTGETSTATE *xinput_get_state;
     XINPUTSETSTATE *xinput_set_state;
+    EXWIN32GAMEPAD gamepads[EX_MAX_GAMEPADS];
 
     HANDLE wgl_context;
+    unsigned int framebuffer_texture;
+    EXINT2 framebuffer_texture_size;
+
+    EXBOOL modern_opengl;
+    unsigned int program;
+    unsigned int vertex_array;
+    unsigned int pixel_buffer;
+    uint8_t *pixel_buffer_memory;
+    int pixel_buffer_capacity;
+    int pixel_buffer_index;
+    void *pixel_buffer_fences[EX_MAX_PIXEL_BUFFERS];
 };
 
 struct EXMU {
     EXBOOL initialized;
     EXBOOL quit;
+    EXBOOL headless;
 
     const char *error;
     char error_buffer[EX_MAX_ERROR];
     
     EXWINDOW window;
+    EXFRAMEBUFFER framebuffer;
     EXTIME time;
+    EXFRAMESTATS frame_stats;
+    EXPROFILE profile;
+    EXREPLAY replay;
+    EXCAPTURE capture;
+    EXSTREAM stream;
     EXKEYBOARD keyboard;
-    EXGAMEPAD gamepad;
+    EXGAMEPAD gamepads[EX_MAX_GAMEPADS];
     EXMOUSE mouse;
 
     const char *text;
@@ -158,3 +444,125 @@ struct EXMU {
 EXBOOL EXMU_initialize(EXMU *state);
 EXBOOL EXMU_pull(EXMU *state);
 EXBOOL EXMU_push(EXMU *state);
+
+void EXMU_update_digital_button(EXDIGITALBUTTON *button, EXBOOL down);
+void EXMU_update_analog_button(EXANALOGBUTTON *button, float value);
+void EXMU_update_stick(EXSTICK *stick, float x, float y);
+
+EXBOOL EXMU_replay_record(EXMU *state, const char *path);
+EXBOOL EXMU_replay_play(EXMU *state, const char *path);
+void EXMU_replay_stop(EXMU *state);
+void EXMU_replay_read(EXMU *state);
+void EXMU_replay_apply(EXMU *state);
+void EXMU_replay_write(EXMU *state);
+
+EXBOOL EXMU_arena_create(EXARENA *arena, size_t size);
+void EXMU_arena_destroy(EXARENA *arena);
+void *EXMU_arena_push(EXARENA *arena, size_t size, size_t alignment);
+void EXMU_arena_reset(EXARENA *arena);
+
+void *EXMU_thread_create(EXTHREADPROC *proc, void *data);
+void EXMU_thread_join(void *thread);
+EXBOOL EXMU_thread_pin(int cpu);
+int EXMU_cpu_count(void);
+uint64_t EXMU_nanoseconds(void);
+void EXMU_sleep(uint32_t milliseconds);
+void *EXMU_semaphore_create(int initial_count, int maximum_count);
+void EXMU_semaphore_destroy(void *semaphore);
+void EXMU_semaphore_signal(void *semaphore);
+EXBOOL EXMU_semaphore_wait(void *semaphore, EXBOOL block);
+
+EXBOOL EXMU_file_open(const char *path, uintptr_t *file);
+int64_t EXMU_file_read(uintptr_t file, uint64_t offset, void *data, uint32_t size);
+void EXMU_file_close(uintptr_t file);
+
+EXBOOL EXMU_module_load(EXMU *state, EXMODULE *module, const char *path);
+EXBOOL EXMU_module_changed(EXMODULE *module);
+void *EXMU_module_symbol(EXMODULE *module, const char *name);
+
+EXBOOL EXMU_udp_open(uintptr_t *socket, uint16_t port);
+void EXMU_udp_close(uintptr_t socket);
+EXBOOL EXMU_udp_send(uintptr_t socket, EXADDRESS address, const void *data, int size);
+int EXMU_udp_receive(uintptr_t socket, EXADDRESS *address, void *data, int capacity);
+
+EXBOOL EXMU_address_parse(EXADDRESS *address, const char *text);
+EXBOOL EXMU_transport_loopback(EXTRANSPORT *a, EXTRANSPORT *b);
+EXBOOL EXMU_transport_udp(EXTRANSPORT *transport, uint16_t port);
+EXBOOL EXMU_transport_send(EXTRANSPORT *transport, EXADDRESS address, const void *data, int size);
+int EXMU_transport_receive(EXTRANSPORT *transport, EXADDRESS *address, void *data, int capacity);
+void EXMU_transport_close(EXTRANSPORT *transport);
+
+EXBOOL EXMU_framebuffer_resize(EXMU *state, int width, int height);
+void EXMU_framebuffer_clear(EXFRAMEBUFFER *framebuffer, uint8_t color);
+void EXMU_framebuffer_fill(EXFRAMEBUFFER *framebuffer, int x, int y, int width, int height, uint8_t color);
+void EXMU_framebuffer_transpose(EXFRAMEBUFFER *framebuffer);
+void EXMU_framebuffer_expand(EXFRAMEBUFFER *framebuffer, uint32_t *pixels);
+
+EXBOOL EXMU_capture_screenshot(EXMU *state, int format);
+EXBOOL EXMU_capture_sequence(EXMU *state, const char *prefix, int format);
+void EXMU_capture_frame(EXMU *state);
+void EXMU_capture_stop(EXMU *state);
+
+EXBOOL EXMU_stream_start(EXMU *state, int slot_count, uint32_t slot_capacity, int thread_count);
+EXBOOL EXMU_stream_request(EXMU *state, uint64_t key, const char *path, uint64_t offset, uint32_t size, EXFLOAT2 position);
+const void *EXMU_stream_find(EXMU *state, uint64_t key, uint32_t *size);
+void EXMU_stream_release(EXMU *state, uint64_t key);
+void EXMU_stream_update(EXMU *state);
+void EXMU_stream_stop(EXMU *state);
+
+void EXMU_frame_stats_push(EXFRAMESTATS *stats, uint64_t delta_nanoseconds);
+int EXMU_frame_stats_size(EXFRAMESTATS *stats);
+uint64_t EXMU_frame_stats_get(EXFRAMESTATS *stats, int age);
+
+EXBOOL EXMU_counters_read(EXCOUNTERS *counters);
+void EXMU_counters_close(void);
+
+void EXMU_profile_record(const char *name, uint64_t begin, uint64_t end);
+void EXMU_profile_record_counters(const char *name, uint64_t begin, uint64_t end, EXCOUNTERS *before, EXCOUNTERS *after);
+void EXMU_profile_frame(EXMU *state);
+void EXMU_profile_thread_exit(void);
+EXBOOL EXMU_profile_export(EXMU *state, const char *path, int frame_count);
+
+inline uint64_t
+EXMU_profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    struct timespec timespec;
+    clock_gettime(CLOCK_MONOTONIC, &timespec);
+    return (uint64_t)timespec.tv_sec * 1000000000ull + (uint64_t)timespec.tv_nsec;
+#endif
+}
+
+struct EXPROFILESCOPE {
+    const char *name;
+    uint64_t begin;
+    EXPROFILESCOPE(const char *name) : name(name), begin(EXMU_profile_ticks()) {}
+    ~EXPROFILESCOPE() { EXMU_profile_record(name, begin, EXMU_profile_ticks()); }
+};
+
+struct EXCOUNTERSCOPE {
+    const char *name;
+    uint64_t begin;
+    EXCOUNTERS counters;
+    EXCOUNTERSCOPE(const char *name) : name(name) {
+        EXMU_counters_read(&counters);
+        begin = EXMU_profile_ticks();
+    }
+    ~EXCOUNTERSCOPE() {
+        uint64_t end = EXMU_profile_ticks();
+        EXCOUNTERS after;
+        EXMU_counters_read(&after);
+        EXMU_profile_record_counters(name, begin, end, &counters, &after);
+    }
+};
+
+#define EX_CONCAT_(a, b) a##b
+#define EX_CONCAT(a, b) EX_CONCAT_(a, b)
+#if EX_PROFILE
+#define EX_PROFILE_SCOPE(name) EXPROFILESCOPE EX_CONCAT(profile_scope_, __LINE__)(name)
+#define EX_COUNTER_SCOPE(name) EXCOUNTERSCOPE EX_CONCAT(counter_scope_, __LINE__)(name)
+#else
+#define EX_PROFILE_SCOPE(name)
+#define EX_COUNTER_SCOPE(name)
+#endif
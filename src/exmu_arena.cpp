@@ -0,0 +1,33 @@
+#include "exmu.h"
+#include <stdlib.h>
+
+EXBOOL
+EXMU_arena_create(EXARENA *arena, size_t size) {
+    arena->base = (uint8_t *)malloc(size);
+    arena->size = arena->base ? size : 0;
+    arena->used = 0;
+    return arena->base != 0;
+}
+
+void
+EXMU_arena_destroy(EXARENA *arena) {
+    free(arena->base);
+    arena->base = 0;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+// the address is aligned rather than the offset, malloc only promises 16 bytes for the base
+void *
+EXMU_arena_push(EXARENA *arena, size_t size, size_t alignment) {
+    uintptr_t address = (uintptr_t)(arena->base + arena->used);
+    size_t offset = arena->used + (((address + alignment - 1) & ~(uintptr_t)(alignment - 1)) - address);
+    if (offset > arena->size || size > arena->size - offset) return 0;
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+void
+EXMU_arena_reset(EXARENA *arena) {
+    arena->used = 0;
+}
@@ -0,0 +1,276 @@
+#include "exmu.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EX_QOI_OP_INDEX 0x00
+#define EX_QOI_OP_DIFF 0x40
+#define EX_QOI_OP_LUMA 0x80
+#define EX_QOI_OP_RUN 0xC0
+#define EX_QOI_OP_RGB 0xFE
+
+static uint8_t *
+EXMU_capture_write_u32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+    return out + 4;
+}
+
+static size_t
+EXMU_capture_encode_qoi(const uint32_t *pixels, int width, int height, uint8_t *out) {
+    uint8_t *cursor = out;
+    memcpy(cursor, "qoif", 4);
+    cursor = EXMU_capture_write_u32(cursor + 4, width);
+    cursor = EXMU_capture_write_u32(cursor, height);
+    *cursor++ = 3; // RGB
+    *cursor++ = 0; // sRGB
+
+    uint32_t index[64] = {};
+    uint32_t previous = 0xFF000000;
+    int run = 0;
+    int count = width * height;
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+        uint32_t pixel = pixels[pixel_index] | 0xFF000000;
+        if (pixel == previous) {
+            run += 1;
+            if (run == 62 || pixel_index == count - 1) {
+                *cursor++ = EX_QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+        if (run) {
+            *cursor++ = EX_QOI_OP_RUN | (run - 1);
+            run = 0;
+        }
+
+        int r = (pixel >> 16) & 0xFF;
+        int g = (pixel >> 8) & 0xFF;
+        int b = pixel & 0xFF;
+        int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+        if (index[hash] == pixel) {
+            *cursor++ = EX_QOI_OP_INDEX | hash;
+        } else {
+            index[hash] = pixel;
+            int8_t vr = (int8_t)(r - ((previous >> 16) & 0xFF));
+            int8_t vg = (int8_t)(g - ((previous >> 8) & 0xFF));
+            int8_t vb = (int8_t)(b - (previous & 0xFF));
+            int vg_r = vr - vg;
+            int vg_b = vb - vg;
+            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                *cursor++ = EX_QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+            } else if (vg > -33 && vg < 32 && vg_r > -9 && vg_r < 8 && vg_b > -9 && vg_b < 8) {
+                *cursor++ = EX_QOI_OP_LUMA | (vg + 32);
+                *cursor++ = (vg_r + 8) << 4 | (vg_b + 8);
+            } else {
+                *cursor++ = EX_QOI_OP_RGB;
+                *cursor++ = (uint8_t)r;
+                *cursor++ = (uint8_t)g;
+                *cursor++ = (uint8_t)b;
+            }
+        }
+        previous = pixel;
+    }
+
+    static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(cursor, padding, sizeof(padding));
+    cursor += sizeof(padding);
+    return cursor - out;
+}
+
+static size_t
+EXMU_capture_encode_ppm(const uint32_t *pixels, int width, int height, uint8_t *out) {
+    uint8_t *cursor = out + sprintf((char *)out, "P6\n%d %d\n255\n", width, height);
+    int count = width * height;
+    for (int pixel_index = 0; pixel_index < count; pixel_index++) {
+        uint32_t pixel = pixels[pixel_index];
+        *cursor++ = (uint8_t)(pixel >> 16);
+        *cursor++ = (uint8_t)(pixel >> 8);
+        *cursor++ = (uint8_t)pixel;
+    }
+    return cursor - out;
+}
+
+static void
+EXMU_capture_writer(void *data) {
+    EXCAPTURE *capture = (EXCAPTURE *)data;
+    uint8_t *encoded = 0;
+    size_t encoded_capacity = 0;
+    for (;;) {
+        EXMU_semaphore_wait(capture->filled_semaphore, EX_TRUE);
+        EXCAPTURESLOT *slot = capture->slots + (capture->tail % EX_MAX_CAPTURE_SLOTS);
+        capture->tail += 1;
+        if (slot->format == EX_CAPTURE_NONE) {
+            EXMU_semaphore_signal(capture->free_semaphore);
+            break;
+        }
+
+        EX_PROFILE_SCOPE("capture");
+        EXFRAMEBUFFER *framebuffer = &slot->framebuffer;
+        EXMU_framebuffer_expand(framebuffer, framebuffer->pixels);
+
+        size_t encoded_size = 32 + (size_t)framebuffer->width * framebuffer->height * 5;
+        if (encoded_size > encoded_capacity) {
+            uint8_t *resized = (uint8_t *)realloc(encoded, encoded_size);
+            if (resized) {
+                encoded = resized;
+                encoded_capacity = encoded_size;
+            }
+        }
+        if (encoded_size <= encoded_capacity) {
+            if (slot->format == EX_CAPTURE_QOI) {
+                encoded_size = EXMU_capture_encode_qoi(framebuffer->pixels, framebuffer->width, framebuffer->height, encoded);
+            } else {
+                encoded_size = EXMU_capture_encode_ppm(framebuffer->pixels, framebuffer->width, framebuffer->height, encoded);
+            }
+            FILE *file = fopen(slot->path, "wb");
+            if (!file || fwrite(encoded, 1, encoded_size, file) != encoded_size) {
+                fprintf(stderr, "Failed to write capture %s.\n", slot->path);
+            }
+            if (file) fclose(file);
+        } else {
+            fprintf(stderr, "Failed to allocate capture %s.\n", slot->path);
+        }
+        EXMU_semaphore_signal(capture->free_semaphore);
+    }
+    free(encoded);
+}
+
+static EXBOOL
+EXMU_capture_reserve(EXCAPTURESLOT *slot, int count) {
+    EXFRAMEBUFFER *framebuffer = &slot->framebuffer;
+    if (count <= framebuffer->capacity) return EX_TRUE;
+    uint8_t *indices = (uint8_t *)realloc(framebuffer->indices, count);
+    if (indices) framebuffer->indices = indices;
+    uint8_t *transposed = (uint8_t *)realloc(framebuffer->transposed, count);
+    if (transposed) framebuffer->transposed = transposed;
+    uint32_t *pixels = (uint32_t *)realloc(framebuffer->pixels, (size_t)count * sizeof(uint32_t));
+    if (pixels) framebuffer->pixels = pixels;
+    if (!indices || !transposed || !pixels) return EX_FALSE;
+    framebuffer->capacity = count;
+    return EX_TRUE;
+}
+
+static EXBOOL
+EXMU_capture_start(EXMU *state) {
+    EXCAPTURE *capture = &state->capture;
+    if (capture->thread) return EX_TRUE;
+
+    int count = state->window.size.x * state->window.size.y;
+    if (count < state->framebuffer.capacity) count = state->framebuffer.capacity;
+    for (int index = 0; index < EX_MAX_CAPTURE_SLOTS; index++) {
+        if (!EXMU_capture_reserve(capture->slots + index, count)) {
+            state->error = "Failed to allocate capture slots.";
+            return EX_FALSE;
+        }
+    }
+
+    capture->head = 0;
+    capture->tail = 0;
+    capture->free_semaphore = EXMU_semaphore_create(EX_MAX_CAPTURE_SLOTS, EX_MAX_CAPTURE_SLOTS);
+    capture->filled_semaphore = EXMU_semaphore_create(0, EX_MAX_CAPTURE_SLOTS);
+    if (capture->free_semaphore && capture->filled_semaphore) {
+        capture->thread = EXMU_thread_create(EXMU_capture_writer, capture);
+    }
+    if (!capture->thread) {
+        EXMU_semaphore_destroy(capture->free_semaphore);
+        EXMU_semaphore_destroy(capture->filled_semaphore);
+        capture->free_semaphore = 0;
+        capture->filled_semaphore = 0;
+        state->error = "Failed to start capture thread.";
+        return EX_FALSE;
+    }
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_capture_screenshot(EXMU *state, int format) {
+    if (!EXMU_capture_start(state)) return EX_FALSE;
+    state->capture.format = format;
+    state->capture.screenshot = EX_TRUE;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_capture_sequence(EXMU *state, const char *prefix, int format) {
+    EXCAPTURE *capture = &state->capture;
+    if (!prefix) {
+        capture->sequence = EX_FALSE;
+        return EX_TRUE;
+    }
+    if (!EXMU_capture_start(state)) return EX_FALSE;
+    capture->format = format;
+    capture->sequence = EX_TRUE;
+    capture->sequence_frame = 0;
+    snprintf(capture->sequence_prefix, EX_MAX_CAPTURE_PATH, "%s", prefix);
+    return EX_TRUE;
+}
+
+void
+EXMU_capture_frame(EXMU *state) {
+    EXCAPTURE *capture = &state->capture;
+    EXFRAMEBUFFER *framebuffer = &state->framebuffer;
+    if (!capture->screenshot && !capture->sequence) return;
+    if (!capture->thread || !framebuffer->indices) return;
+
+    const char *extension = capture->format == EX_CAPTURE_QOI ? "qoi" : "ppm";
+    uint64_t sequence_frame = capture->sequence_frame;
+    if (capture->sequence) capture->sequence_frame += 1;
+    if (!EXMU_semaphore_wait(capture->free_semaphore, EX_FALSE)) {
+        capture->dropped += 1;
+        return;
+    }
+
+    EX_PROFILE_SCOPE("capture copy");
+    EXCAPTURESLOT *slot = capture->slots + (capture->head % EX_MAX_CAPTURE_SLOTS);
+    int count = framebuffer->width * framebuffer->height;
+    if (!EXMU_capture_reserve(slot, count)) {
+        EXMU_semaphore_signal(capture->free_semaphore);
+        capture->dropped += 1;
+        return;
+    }
+    slot->framebuffer.width = framebuffer->width;
+    slot->framebuffer.height = framebuffer->height;
+    memcpy(slot->framebuffer.indices, framebuffer->indices, count);
+    memcpy(slot->framebuffer.palette, framebuffer->palette, sizeof(framebuffer->palette));
+    slot->format = capture->format;
+    if (capture->screenshot) {
+        snprintf(slot->path, EX_MAX_CAPTURE_PATH, "screenshot_%04llu.%s",
+                 (unsigned long long)capture->screenshot_count++, extension);
+        capture->screenshot = EX_FALSE;
+    } else {
+        snprintf(slot->path, EX_MAX_CAPTURE_PATH, "%s_%06llu.%s",
+                 capture->sequence_prefix, (unsigned long long)sequence_frame, extension);
+    }
+    capture->head += 1;
+    capture->captured += 1;
+    EXMU_semaphore_signal(capture->filled_semaphore);
+}
+
+void
+EXMU_capture_stop(EXMU *state) {
+    EXCAPTURE *capture = &state->capture;
+    capture->screenshot = EX_FALSE;
+    capture->sequence = EX_FALSE;
+    if (!capture->thread) return;
+
+    EXMU_semaphore_wait(capture->free_semaphore, EX_TRUE);
+    capture->slots[capture->head % EX_MAX_CAPTURE_SLOTS].format = EX_CAPTURE_NONE;
+    capture->head += 1;
+    EXMU_semaphore_signal(capture->filled_semaphore);
+    EXMU_thread_join(capture->thread);
+    capture->thread = 0;
+
+    EXMU_semaphore_destroy(capture->free_semaphore);
+    EXMU_semaphore_destroy(capture->filled_semaphore);
+    capture->free_semaphore = 0;
+    capture->filled_semaphore = 0;
+    for (int index = 0; index < EX_MAX_CAPTURE_SLOTS; index++) {
+        EXFRAMEBUFFER *framebuffer = &capture->slots[index].framebuffer;
+        free(framebuffer->indices);
+        free(framebuffer->transposed);
+        free(framebuffer->pixels);
+        memset(framebuffer, 0, sizeof(EXFRAMEBUFFER));
+    }
+}
@@ -0,0 +1,96 @@
+#include "exmu.h"
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define EX_COUNTERS_UNOPENED 0
+#define EX_COUNTERS_OPEN 1
+#define EX_COUNTERS_UNAVAILABLE 2
+
+static const uint64_t counter_configs[EX_MAX_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static thread_local int counter_status;
+static thread_local int counter_leader = -1;
+static thread_local int counter_fds[EX_MAX_COUNTERS];
+static thread_local int counter_count;
+static thread_local int counter_indices[EX_MAX_COUNTERS];
+
+static int
+EXMU_counters_open_event(int counter, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = counter_configs[counter];
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // user space only, so it still opens with perf_event_paranoid at 2
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// each thread opens one group on first use, counters the kernel or VM refuses are left out of the mask
+static EXBOOL
+EXMU_counters_open(void) {
+    counter_count = 0;
+    for (int counter = 0; counter < EX_MAX_COUNTERS; counter++) {
+        int fd = EXMU_counters_open_event(counter, counter_leader);
+        if (fd < 0) continue;
+        if (counter_leader < 0) counter_leader = fd;
+        counter_fds[counter_count] = fd;
+        counter_indices[counter_count] = counter;
+        counter_count += 1;
+    }
+    counter_status = counter_count ? EX_COUNTERS_OPEN : EX_COUNTERS_UNAVAILABLE;
+    return counter_count != 0;
+}
+
+EXBOOL
+EXMU_counters_read(EXCOUNTERS *counters) {
+    memset(counters, 0, sizeof(EXCOUNTERS));
+    if (counter_status == EX_COUNTERS_UNAVAILABLE) return EX_FALSE;
+    if (counter_status == EX_COUNTERS_UNOPENED && !EXMU_counters_open()) return EX_FALSE;
+
+    uint64_t buffer[3 + EX_MAX_COUNTERS];
+    ssize_t size = read(counter_leader, buffer, sizeof(buffer));
+    if (size < (ssize_t)(3 * sizeof(uint64_t)) || buffer[0] != (uint64_t)counter_count) return EX_FALSE;
+    uint64_t enabled = buffer[1];
+    uint64_t running = buffer[2];
+    if (!running) return EX_FALSE;
+
+    // scaled up when the kernel had to multiplex the group with other users of the PMU
+    for (int index = 0; index < counter_count; index++) {
+        uint64_t value = buffer[3 + index];
+        if (running < enabled) value = (uint64_t)((double)value * enabled / running);
+        counters->values[counter_indices[index]] = value;
+        counters->mask |= 1u << counter_indices[index];
+    }
+    return EX_TRUE;
+}
+
+void
+EXMU_counters_close(void) {
+    for (int index = 0; index < counter_count; index++) close(counter_fds[index]);
+    counter_count = 0;
+    counter_leader = -1;
+    counter_status = EX_COUNTERS_UNOPENED;
+}
+
+#else
+
+EXBOOL
+EXMU_counters_read(EXCOUNTERS *counters) {
+    memset(counters, 0, sizeof(EXCOUNTERS));
+    return EX_FALSE;
+}
+
+void
+EXMU_counters_close(void) {
+}
+
+#endif
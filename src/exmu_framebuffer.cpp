@@ -0,0 +1,132 @@
+#include "exmu.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define EX_FRAMEBUFFER_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EX_FRAMEBUFFER_SSE2 1
+#endif
+
+#define EX_FRAMEBUFFER_BLOCK 16
+
+EXBOOL
+EXMU_framebuffer_resize(EXMU *state, int width, int height) {
+    EXFRAMEBUFFER *framebuffer = &state->framebuffer;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (width * height > framebuffer->capacity) {
+        uint8_t *indices = (uint8_t *)realloc(framebuffer->indices, (size_t)width * height);
+        if (indices) framebuffer->indices = indices;
+        uint8_t *transposed = (uint8_t *)realloc(framebuffer->transposed, (size_t)width * height);
+        if (transposed) framebuffer->transposed = transposed;
+        uint32_t *pixels = (uint32_t *)realloc(framebuffer->pixels, (size_t)width * height * sizeof(uint32_t));
+        if (pixels) framebuffer->pixels = pixels;
+        if (!indices || !transposed || !pixels) {
+            state->error = "Failed to allocate framebuffer.";
+            return EX_FALSE;
+        }
+        framebuffer->capacity = width * height;
+    }
+    framebuffer->width = width;
+    framebuffer->height = height;
+    return EX_TRUE;
+}
+
+void
+EXMU_framebuffer_clear(EXFRAMEBUFFER *framebuffer, uint8_t color) {
+    memset(framebuffer->indices, color, (size_t)framebuffer->width * framebuffer->height);
+}
+
+void
+EXMU_framebuffer_fill(EXFRAMEBUFFER *framebuffer, int x, int y, int width, int height, uint8_t color) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + width > framebuffer->width ? framebuffer->width : x + width;
+    int y1 = y + height > framebuffer->height ? framebuffer->height : y + height;
+    if (y0 >= y1) return;
+    for (int column = x0; column < x1; column++) {
+        memset(framebuffer->indices + column * framebuffer->height + y0, color, y1 - y0);
+    }
+}
+
+#ifdef EX_FRAMEBUFFER_SSE2
+// four rounds of interleaving rotate the 8-bit (row, column) address by four bits, which swaps row and column
+static inline void
+EXMU_framebuffer_transpose_block(const uint8_t *source, int source_stride, uint8_t *destination, int destination_stride) {
+    __m128i x[16], t[16];
+    for (int index = 0; index < 16; index++) x[index] = _mm_loadu_si128((const __m128i *)(source + index * source_stride));
+    for (int round = 0; round < 4; round++) {
+        for (int index = 0; index < 8; index++) {
+            t[2 * index + 0] = _mm_unpacklo_epi8(x[index], x[index + 8]);
+            t[2 * index + 1] = _mm_unpackhi_epi8(x[index], x[index + 8]);
+        }
+        for (int index = 0; index < 16; index++) x[index] = t[index];
+    }
+    for (int index = 0; index < 16; index++) _mm_storeu_si128((__m128i *)(destination + index * destination_stride), x[index]);
+}
+#endif
+
+void
+EXMU_framebuffer_transpose(EXFRAMEBUFFER *framebuffer) {
+    const uint8_t *source = framebuffer->indices;
+    uint8_t *destination = framebuffer->transposed;
+    int width = framebuffer->width;
+    int height = framebuffer->height;
+    int block_width = 0;
+    int block_height = 0;
+#ifdef EX_FRAMEBUFFER_SSE2
+    block_width = width & ~(EX_FRAMEBUFFER_BLOCK - 1);
+    block_height = height & ~(EX_FRAMEBUFFER_BLOCK - 1);
+    for (int row = 0; row < block_height; row += EX_FRAMEBUFFER_BLOCK) {
+        for (int column = 0; column < block_width; column += EX_FRAMEBUFFER_BLOCK) {
+            EXMU_framebuffer_transpose_block(source + column * height + row, height,
+                                             destination + row * width + column, width);
+        }
+    }
+#endif
+    // EDGES
+    for (int row = 0; row < height; row++) {
+        int column = row < block_height ? block_width : 0;
+        for (; column < width; column++) destination[row * width + column] = source[column * height + row];
+    }
+}
+
+#ifdef EX_FRAMEBUFFER_AVX2
+__attribute__((target("avx2"))) int
+EXMU_framebuffer_expand_avx2(const uint8_t *indices, uint32_t *pixels, const uint32_t *palette, int count) {
+    int index = 0;
+    for (; index + 8 <= count; index += 8) {
+        __m128i bytes = _mm_loadl_epi64((const __m128i *)(indices + index));
+        __m256i lanes = _mm256_cvtepu8_epi32(bytes);
+        __m256i colors = _mm256_i32gather_epi32((const int *)palette, lanes, 4);
+        _mm256_storeu_si256((__m256i *)(pixels + index), colors);
+    }
+    return index;
+}
+#endif
+
+void
+EXMU_framebuffer_expand(EXFRAMEBUFFER *framebuffer, uint32_t *pixels) {
+    EXMU_framebuffer_transpose(framebuffer);
+    const uint8_t *indices = framebuffer->transposed;
+    const uint32_t *palette = framebuffer->palette;
+    int count = framebuffer->width * framebuffer->height;
+    int index = 0;
+#ifdef EX_FRAMEBUFFER_AVX2
+    // the capture writer expands on its own thread, a function static is initialized exactly once
+    static const int avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) index = EXMU_framebuffer_expand_avx2(indices, pixels, palette, count);
+#endif
+    for (; index + 4 <= count; index += 4) {
+        pixels[index + 0] = palette[indices[index + 0]];
+        pixels[index + 1] = palette[indices[index + 1]];
+        pixels[index + 2] = palette[indices[index + 2]];
+        pixels[index + 3] = palette[indices[index + 3]];
+    }
+    for (; index < count; index++) pixels[index] = palette[indices[index]];
+}
@@ -0,0 +1,199 @@
+#include "exmu.h"
+#include <stdlib.h>
+#include <atomic>
+
+struct EXPROFILEEVENT {
+    const char *name;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t counter_mask;
+    uint64_t counters[EX_MAX_COUNTERS];
+};
+
+static const char *counter_names[EX_MAX_COUNTERS] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+// a buffer whose thread exited is retired and handed to the next thread that registers, head keeps
+// counting across owners so an export that is still copying it sees the reuse as wrapping
+struct EXPROFILEBUFFER {
+    uint32_t thread_index;
+    std::atomic<int> retired;
+    std::atomic<uint64_t> head;
+    EXPROFILEEVENT events[EX_MAX_PROFILE_EVENTS];
+};
+
+static std::atomic<EXPROFILEBUFFER *> profile_buffers[EX_MAX_PROFILE_THREADS];
+static std::atomic<uint32_t> profile_buffer_count;
+static thread_local EXPROFILEBUFFER *profile_thread_buffer;
+static thread_local EXBOOL profile_thread_full;
+
+static EXPROFILEBUFFER *
+EXMU_profile_register_thread(void) {
+    uint32_t buffer_count = profile_buffer_count.load(std::memory_order_acquire);
+    if (buffer_count > EX_MAX_PROFILE_THREADS) buffer_count = EX_MAX_PROFILE_THREADS;
+    for (uint32_t buffer_index = 0; buffer_index < buffer_count; buffer_index++) {
+        EXPROFILEBUFFER *buffer = profile_buffers[buffer_index].load(std::memory_order_acquire);
+        int retired = 1;
+        if (!buffer || !buffer->retired.compare_exchange_strong(retired, 0, std::memory_order_acquire)) continue;
+        profile_thread_buffer = buffer;
+        return buffer;
+    }
+
+    uint32_t thread_index = profile_buffer_count.fetch_add(1);
+    if (thread_index >= EX_MAX_PROFILE_THREADS) {
+        profile_thread_full = EX_TRUE;
+        return 0;
+    }
+    EXPROFILEBUFFER *buffer = (EXPROFILEBUFFER *)calloc(1, sizeof(EXPROFILEBUFFER));
+    if (!buffer) {
+        profile_thread_full = EX_TRUE;
+        return 0;
+    }
+    buffer->thread_index = thread_index;
+    buffer->retired.store(0, std::memory_order_relaxed);
+    buffer->head.store(0, std::memory_order_relaxed);
+    profile_thread_buffer = buffer;
+    profile_buffers[thread_index].store(buffer, std::memory_order_release);
+    return buffer;
+}
+
+// called by the thread trampoline as a thread exits, its events stay exportable until the buffer is reused
+void
+EXMU_profile_thread_exit(void) {
+    EXPROFILEBUFFER *buffer = profile_thread_buffer;
+    profile_thread_buffer = 0;
+    profile_thread_full = EX_FALSE;
+    if (buffer) buffer->retired.store(1, std::memory_order_release);
+}
+
+static EXPROFILEEVENT *
+EXMU_profile_push(const char *name, uint64_t begin, uint64_t end) {
+    EXPROFILEBUFFER *buffer = profile_thread_buffer;
+    if (!buffer) {
+        if (profile_thread_full) return 0;
+        buffer = EXMU_profile_register_thread();
+        if (!buffer) return 0;
+    }
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    EXPROFILEEVENT *event = buffer->events + (head & (EX_MAX_PROFILE_EVENTS - 1));
+    event->name = name;
+    event->begin = begin;
+    event->end = end;
+    event->counter_mask = 0;
+    return event;
+}
+
+static void
+EXMU_profile_commit(void) {
+    EXPROFILEBUFFER *buffer = profile_thread_buffer;
+    buffer->head.store(buffer->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void
+EXMU_profile_record(const char *name, uint64_t begin, uint64_t end) {
+    EXPROFILEEVENT *event = EXMU_profile_push(name, begin, end);
+    if (!event) return;
+    EXMU_profile_commit();
+}
+
+void
+EXMU_profile_record_counters(const char *name, uint64_t begin, uint64_t end, EXCOUNTERS *before, EXCOUNTERS *after) {
+    EXPROFILEEVENT *event = EXMU_profile_push(name, begin, end);
+    if (!event) return;
+    event->counter_mask = before->mask & after->mask;
+    for (int counter = 0; counter < EX_MAX_COUNTERS; counter++) {
+        event->counters[counter] = after->values[counter] - before->values[counter];
+    }
+    EXMU_profile_commit();
+}
+
+void
+EXMU_profile_frame(EXMU *state) {
+    EXPROFILE *profile = &state->profile;
+    uint64_t ticks = EXMU_profile_ticks();
+    if (!profile->frame_count) {
+        profile->calibration_ticks = ticks;
+        profile->calibration_time_ticks = state->time.ticks;
+    } else if (state->time.ticks > profile->calibration_time_ticks) {
+        uint64_t elapsed_ticks = ticks - profile->calibration_ticks;
+        uint64_t elapsed_time_ticks = state->time.ticks - profile->calibration_time_ticks;
+        profile->ticks_per_second = (double)elapsed_ticks * (double)state->time.ticks_per_second / (double)elapsed_time_ticks;
+    }
+    profile->frame_ticks[profile->frame_count % EX_MAX_PROFILE_FRAMES] = ticks;
+    profile->frame_count += 1;
+}
+
+EXBOOL
+EXMU_profile_export(EXMU *state, const char *path, int frame_count) {
+    EXPROFILE *profile = &state->profile;
+    if (profile->frame_count < 2 || profile->ticks_per_second <= 0.0) {
+        state->error = "Not enough profiled frames to export.";
+        return EX_FALSE;
+    }
+
+    uint64_t available_frames = profile->frame_count - 1;
+    if (available_frames > EX_MAX_PROFILE_FRAMES - 1) available_frames = EX_MAX_PROFILE_FRAMES - 1;
+    if (frame_count < 1) frame_count = 1;
+    if ((uint64_t)frame_count > available_frames) frame_count = (int)available_frames;
+
+    uint64_t last_frame = profile->frame_count - 1;
+    uint64_t first_frame = last_frame - frame_count;
+    uint64_t begin_ticks = profile->frame_ticks[first_frame % EX_MAX_PROFILE_FRAMES];
+    double microseconds_per_tick = 1000000.0 / profile->ticks_per_second;
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        state->error = "Failed to open profile export file.";
+        return EX_FALSE;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+            state->window.title ? state->window.title : "EXMU");
+
+    for (uint64_t frame = first_frame; frame <= last_frame; frame++) {
+        uint64_t ticks = profile->frame_ticks[frame % EX_MAX_PROFILE_FRAMES];
+        fprintf(file, ",\n{\"name\":\"frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f}",
+                (unsigned long long)frame, (double)(ticks - begin_ticks) * microseconds_per_tick);
+    }
+
+    uint32_t buffer_count = profile_buffer_count.load(std::memory_order_acquire);
+    if (buffer_count > EX_MAX_PROFILE_THREADS) buffer_count = EX_MAX_PROFILE_THREADS;
+    for (uint32_t buffer_index = 0; buffer_index < buffer_count; buffer_index++) {
+        EXPROFILEBUFFER *buffer = profile_buffers[buffer_index].load(std::memory_order_acquire);
+        if (!buffer) continue;
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        // once wrapped, the oldest slot is the one the writer fills next, so it is left out
+        uint64_t tail = head >= EX_MAX_PROFILE_EVENTS ? head - EX_MAX_PROFILE_EVENTS + 1 : 0;
+        for (uint64_t index = tail; index < head; index++) {
+            EXPROFILEEVENT event = buffer->events[index & (EX_MAX_PROFILE_EVENTS - 1)];
+            // the writer kept going during the export and may have reused the slot while it was copied
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer->head.load(std::memory_order_relaxed) >= index + EX_MAX_PROFILE_EVENTS) continue;
+            if (event.end < begin_ticks || event.end < event.begin) continue;
+            uint64_t begin = event.begin > begin_ticks ? event.begin : begin_ticks;
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                    event.name, buffer->thread_index,
+                    (double)(begin - begin_ticks) * microseconds_per_tick,
+                    (double)(event.end - begin) * microseconds_per_tick);
+            if (event.counter_mask) {
+                const char *separator = "";
+                fprintf(file, ",\"args\":{");
+                for (int counter = 0; counter < EX_MAX_COUNTERS; counter++) {
+                    if (!(event.counter_mask & (1u << counter))) continue;
+                    fprintf(file, "%s\"%s\":%llu", separator, counter_names[counter], (unsigned long long)event.counters[counter]);
+                    separator = ",";
+                }
+                uint32_t ipc_mask = (1u << EX_COUNTER_CYCLES) | (1u << EX_COUNTER_INSTRUCTIONS);
+                if ((event.counter_mask & ipc_mask) == ipc_mask && event.counters[EX_COUNTER_CYCLES]) {
+                    fprintf(file, ",\"ipc\":%.3f", (double)event.counters[EX_COUNTER_INSTRUCTIONS] / event.counters[EX_COUNTER_CYCLES]);
+                }
+                fprintf(file, "}");
+            }
+            fprintf(file, "}");
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return EX_TRUE;
+}
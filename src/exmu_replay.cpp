@@ -0,0 +1,345 @@
+#include "exmu.h"
+#include <string.h>
+
+enum {
+    EX_REPLAY_VERSION = 3,
+    EX_REPLAY_KEYS = 0x01,
+    EX_REPLAY_GAMEPAD = 0x02,
+    EX_REPLAY_MOUSE = 0x04,
+    EX_REPLAY_TEXT = 0x08,
+    EX_REPLAY_HISTOGRAM_BUCKET = 100 * 1000,
+};
+
+static const char replay_magic[4] = { 'E', 'X', 'R', 'P' };
+
+void
+EXMU_replay_gamepad_buttons(EXGAMEPAD *gamepad, EXDIGITALBUTTON **buttons) {
+    buttons[0] = &gamepad->up_button;
+    buttons[1] = &gamepad->down_button;
+    buttons[2] = &gamepad->left_button;
+    buttons[3] = &gamepad->right_button;
+    buttons[4] = &gamepad->start_button;
+    buttons[5] = &gamepad->back_button;
+    buttons[6] = &gamepad->left_thumb_button;
+    buttons[7] = &gamepad->right_thumb_button;
+    buttons[8] = &gamepad->left_shoulder_button;
+    buttons[9] = &gamepad->right_shoulder_button;
+    buttons[10] = &gamepad->a_button;
+    buttons[11] = &gamepad->b_button;
+    buttons[12] = &gamepad->x_button;
+    buttons[13] = &gamepad->y_button;
+}
+
+void
+EXMU_replay_write_varint(FILE *file, uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+void
+EXMU_replay_write_signed(FILE *file, int64_t value) {
+    EXMU_replay_write_varint(file, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+EXBOOL
+EXMU_replay_read_varint(FILE *file, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) return EX_FALSE;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return EX_TRUE;
+    }
+    return EX_FALSE;
+}
+
+EXBOOL
+EXMU_replay_read_signed(FILE *file, int *value) {
+    uint64_t zigzag;
+    if (!EXMU_replay_read_varint(file, &zigzag)) return EX_FALSE;
+    *value = (int)((int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_replay_record(EXMU *state, const char *path) {
+    EXMU_replay_stop(state);
+    state->replay.file = fopen(path, "wb");
+    if (!state->replay.file) {
+        state->error = "Failed to open replay file for recording.";
+        return EX_FALSE;
+    }
+    fwrite(replay_magic, 1, sizeof(replay_magic), state->replay.file);
+    fputc(EX_REPLAY_VERSION, state->replay.file);
+    // deltas are stored in the recording's own ticks so playback reproduces delta_seconds exactly
+    EXMU_replay_write_varint(state->replay.file, state->time.ticks_per_second);
+    memset(&state->replay.previous_frame, 0, sizeof(state->replay.previous_frame));
+    state->replay.mode = EX_REPLAY_RECORD;
+    state->replay.frame_count = 0;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_replay_play(EXMU *state, const char *path) {
+    EXMU_replay_stop(state);
+    state->replay.file = fopen(path, "rb");
+    if (!state->replay.file) {
+        state->error = "Failed to open replay file for playback.";
+        return EX_FALSE;
+    }
+    char magic[sizeof(replay_magic)];
+    if (fread(magic, 1, sizeof(magic), state->replay.file) != sizeof(magic) ||
+        memcmp(magic, replay_magic, sizeof(magic)) != 0 ||
+        fgetc(state->replay.file) != EX_REPLAY_VERSION ||
+        !EXMU_replay_read_varint(state->replay.file, &state->replay.ticks_per_second) ||
+        !state->replay.ticks_per_second) {
+        fclose(state->replay.file);
+        state->replay.file = 0;
+        state->error = "Replay file is not a valid EXMU replay.";
+        return EX_FALSE;
+    }
+    memset(&state->replay.frame, 0, sizeof(state->replay.frame));
+    state->replay.mode = EX_REPLAY_PLAYBACK;
+    state->replay.frame_count = 0;
+    state->replay.wall_nanoseconds = 0;
+    state->replay.wall_max_nanoseconds = 0;
+    memset(state->replay.wall_histogram, 0, sizeof(state->replay.wall_histogram));
+    return EX_TRUE;
+}
+
+double
+EXMU_replay_percentile(EXREPLAY *replay, int percent) {
+    uint64_t target = (replay->frame_count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < EX_MAX_REPLAY_HISTOGRAM; bucket++) {
+        seen += replay->wall_histogram[bucket];
+        if (seen >= target) return (bucket + 1) * (EX_REPLAY_HISTOGRAM_BUCKET / 1000000.0);
+    }
+    return EX_MAX_REPLAY_HISTOGRAM * (EX_REPLAY_HISTOGRAM_BUCKET / 1000000.0);
+}
+
+void
+EXMU_replay_stop(EXMU *state) {
+    EXREPLAY *replay = &state->replay;
+    if (replay->mode == EX_REPLAY_PLAYBACK && replay->frame_count) {
+        printf("replay: frames %llu wall %.3f ms avg %.3f ms p50 %.1f ms p95 %.1f ms p99 %.1f ms max %.3f ms\n",
+               (unsigned long long)replay->frame_count,
+               replay->wall_nanoseconds / 1000000.0,
+               replay->wall_nanoseconds / 1000000.0 / replay->frame_count,
+               EXMU_replay_percentile(replay, 50),
+               EXMU_replay_percentile(replay, 95),
+               EXMU_replay_percentile(replay, 99),
+               replay->wall_max_nanoseconds / 1000000.0);
+    }
+    if (replay->file) fclose(replay->file);
+    replay->file = 0;
+    replay->mode = EX_REPLAY_NONE;
+}
+
+void
+EXMU_replay_write(EXMU *state) {
+    EXREPLAY *replay = &state->replay;
+    if (replay->mode != EX_REPLAY_RECORD) return;
+
+    EXREPLAYFRAME *frame = &replay->frame;
+    EXREPLAYFRAME *previous = &replay->previous_frame;
+    memset(frame, 0, sizeof(*frame));
+    frame->delta_ticks = state->time.delta_ticks;
+
+    for (int key = 0; key < EX_MAX_KEYS; key++) {
+        if (state->keyboard.keys[key].down) frame->keys[key / 8] |= 1 << (key % 8);
+    }
+
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        EXGAMEPAD *gamepad = state->gamepads + index;
+        EXREPLAYGAMEPAD *replay_gamepad = frame->gamepads + index;
+        EXDIGITALBUTTON *buttons[14];
+        EXMU_replay_gamepad_buttons(gamepad, buttons);
+        replay_gamepad->connected = gamepad->connected;
+        for (int button = 0; button < 14; button++) {
+            if (buttons[button]->down) replay_gamepad->buttons |= 1 << button;
+        }
+        replay_gamepad->triggers[0] = (uint8_t)(gamepad->left_trigger.value * 255.0f);
+        replay_gamepad->triggers[1] = (uint8_t)(gamepad->right_trigger.value * 255.0f);
+        replay_gamepad->sticks[0] = (int16_t)(gamepad->left_thumb_stick.x * 32767.0f);
+        replay_gamepad->sticks[1] = (int16_t)(gamepad->left_thumb_stick.y * 32767.0f);
+        replay_gamepad->sticks[2] = (int16_t)(gamepad->right_thumb_stick.x * 32767.0f);
+        replay_gamepad->sticks[3] = (int16_t)(gamepad->right_thumb_stick.y * 32767.0f);
+    }
+
+    frame->mouse_position = state->mouse.position;
+    frame->mouse_delta_position = state->mouse.delta_position;
+    frame->mouse_delta_wheel = state->mouse.delta_wheel;
+    frame->mouse_buttons = state->mouse.left_button.down | (state->mouse.right_button.down << 1);
+
+    if (state->text) {
+        frame->text_length = (uint32_t)strlen(state->text);
+        memcpy(frame->text, state->text, frame->text_length);
+    }
+
+    uint8_t flags = 0;
+    if (memcmp(frame->keys, previous->keys, sizeof(frame->keys)) != 0) flags |= EX_REPLAY_KEYS;
+    uint8_t gamepad_mask = 0;
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        if (memcmp(frame->gamepads + index, previous->gamepads + index, sizeof(EXREPLAYGAMEPAD)) != 0) gamepad_mask |= 1 << index;
+    }
+    if (gamepad_mask) flags |= EX_REPLAY_GAMEPAD;
+    if (frame->mouse_position.x != previous->mouse_position.x ||
+        frame->mouse_position.y != previous->mouse_position.y ||
+        frame->mouse_delta_position.x || frame->mouse_delta_position.y ||
+        frame->mouse_delta_wheel || frame->mouse_buttons != previous->mouse_buttons) {
+        flags |= EX_REPLAY_MOUSE;
+    }
+    if (frame->text_length) flags |= EX_REPLAY_TEXT;
+
+    FILE *file = replay->file;
+    fputc(flags, file);
+    EXMU_replay_write_varint(file, frame->delta_ticks);
+    if (flags & EX_REPLAY_KEYS) {
+        fwrite(frame->keys, 1, sizeof(frame->keys), file);
+    }
+    if (flags & EX_REPLAY_GAMEPAD) {
+        fputc(gamepad_mask, file);
+        for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+            if (!(gamepad_mask & (1 << index))) continue;
+            EXREPLAYGAMEPAD *replay_gamepad = frame->gamepads + index;
+            fputc(replay_gamepad->connected, file);
+            fputc(replay_gamepad->buttons & 0xFF, file);
+            fputc(replay_gamepad->buttons >> 8, file);
+            fwrite(replay_gamepad->triggers, 1, sizeof(replay_gamepad->triggers), file);
+            for (int stick = 0; stick < 4; stick++) {
+                uint16_t value = (uint16_t)replay_gamepad->sticks[stick];
+                fputc(value & 0xFF, file);
+                fputc(value >> 8, file);
+            }
+        }
+    }
+    if (flags & EX_REPLAY_MOUSE) {
+        EXMU_replay_write_signed(file, frame->mouse_position.x - previous->mouse_position.x);
+        EXMU_replay_write_signed(file, frame->mouse_position.y - previous->mouse_position.y);
+        EXMU_replay_write_signed(file, frame->mouse_delta_position.x);
+        EXMU_replay_write_signed(file, frame->mouse_delta_position.y);
+        EXMU_replay_write_signed(file, frame->mouse_delta_wheel);
+        fputc(frame->mouse_buttons, file);
+    }
+    if (flags & EX_REPLAY_TEXT) {
+        EXMU_replay_write_varint(file, frame->text_length);
+        fwrite(frame->text, 1, frame->text_length, file);
+    }
+
+    *previous = *frame;
+    replay->frame_count += 1;
+}
+
+void
+EXMU_replay_read(EXMU *state) {
+    EXREPLAY *replay = &state->replay;
+    if (replay->mode != EX_REPLAY_PLAYBACK) return;
+
+    FILE *file = replay->file;
+    EXREPLAYFRAME *frame = &replay->frame;
+    int flags = fgetc(file);
+    EXBOOL valid = flags != EOF && EXMU_replay_read_varint(file, &frame->delta_ticks);
+    if (valid && (flags & EX_REPLAY_KEYS)) {
+        valid = fread(frame->keys, 1, sizeof(frame->keys), file) == sizeof(frame->keys);
+    }
+    if (valid && (flags & EX_REPLAY_GAMEPAD)) {
+        int gamepad_mask = fgetc(file);
+        valid = gamepad_mask != EOF;
+        for (int index = 0; valid && index < EX_MAX_GAMEPADS; index++) {
+            if (!(gamepad_mask & (1 << index))) continue;
+            EXREPLAYGAMEPAD *replay_gamepad = frame->gamepads + index;
+            uint8_t bytes[13];
+            valid = fread(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+            replay_gamepad->connected = bytes[0];
+            replay_gamepad->buttons = bytes[1] | (bytes[2] << 8);
+            replay_gamepad->triggers[0] = bytes[3];
+            replay_gamepad->triggers[1] = bytes[4];
+            for (int stick = 0; stick < 4; stick++) {
+                replay_gamepad->sticks[stick] = (int16_t)(bytes[5 + stick * 2] | (bytes[6 + stick * 2] << 8));
+            }
+        }
+    }
+    if (valid && (flags & EX_REPLAY_MOUSE)) {
+        int delta_x = 0, delta_y = 0;
+        valid = EXMU_replay_read_signed(file, &delta_x) &&
+                EXMU_replay_read_signed(file, &delta_y) &&
+                EXMU_replay_read_signed(file, &frame->mouse_delta_position.x) &&
+                EXMU_replay_read_signed(file, &frame->mouse_delta_position.y) &&
+                EXMU_replay_read_signed(file, &frame->mouse_delta_wheel);
+        frame->mouse_position.x += delta_x;
+        frame->mouse_position.y += delta_y;
+        int buttons = fgetc(file);
+        if (buttons == EOF) valid = EX_FALSE;
+        frame->mouse_buttons = (uint8_t)buttons;
+    } else {
+        frame->mouse_delta_position.x = 0;
+        frame->mouse_delta_position.y = 0;
+        frame->mouse_delta_wheel = 0;
+    }
+    frame->text_length = 0;
+    if (valid && (flags & EX_REPLAY_TEXT)) {
+        uint64_t text_length;
+        valid = EXMU_replay_read_varint(file, &text_length) && text_length < EX_MAX_TEXT &&
+                fread(frame->text, 1, text_length, file) == text_length;
+        if (valid) frame->text_length = (uint32_t)text_length;
+    }
+
+    if (!valid) {
+        EXMU_replay_stop(state);
+        state->quit = EX_TRUE;
+    }
+}
+
+void
+EXMU_replay_apply(EXMU *state) {
+    EXREPLAY *replay = &state->replay;
+    if (replay->mode != EX_REPLAY_PLAYBACK) return;
+
+    EXREPLAYFRAME *frame = &replay->frame;
+    for (int key = 0; key < EX_MAX_KEYS; key++) {
+        EXMU_update_digital_button(state->keyboard.keys + key, (frame->keys[key / 8] >> (key % 8)) & 1);
+    }
+
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        EXGAMEPAD *gamepad = state->gamepads + index;
+        EXREPLAYGAMEPAD *replay_gamepad = frame->gamepads + index;
+        EXDIGITALBUTTON *buttons[14];
+        EXMU_replay_gamepad_buttons(gamepad, buttons);
+        gamepad->connected = replay_gamepad->connected;
+        for (int button = 0; button < 14; button++) {
+            EXMU_update_digital_button(buttons[button], (replay_gamepad->buttons >> button) & 1);
+        }
+        EXMU_update_analog_button(&gamepad->left_trigger, replay_gamepad->triggers[0] / 255.0f);
+        EXMU_update_analog_button(&gamepad->right_trigger, replay_gamepad->triggers[1] / 255.0f);
+        EXMU_update_stick(&gamepad->left_thumb_stick, replay_gamepad->sticks[0] / 32767.0f, replay_gamepad->sticks[1] / 32767.0f);
+        EXMU_update_stick(&gamepad->right_thumb_stick, replay_gamepad->sticks[2] / 32767.0f, replay_gamepad->sticks[3] / 32767.0f);
+    }
+
+    state->mouse.position = frame->mouse_position;
+    state->mouse.delta_position = frame->mouse_delta_position;
+    state->mouse.delta_wheel = frame->mouse_delta_wheel;
+    state->mouse.wheel += frame->mouse_delta_wheel;
+    EXMU_update_digital_button(&state->mouse.left_button, frame->mouse_buttons & 1);
+    EXMU_update_digital_button(&state->mouse.right_button, (frame->mouse_buttons >> 1) & 1);
+
+    state->text = 0;
+    state->text_end = state->text_buffer;
+    if (frame->text_length) {
+        memcpy(state->text_buffer, frame->text, frame->text_length);
+        state->text_buffer[frame->text_length] = 0;
+        state->text_end = state->text_buffer + frame->text_length;
+        state->text = state->text_buffer;
+    }
+
+    uint64_t wall_nanoseconds = state->time.wall_delta_nanoseconds;
+    uint64_t bucket = wall_nanoseconds / EX_REPLAY_HISTOGRAM_BUCKET;
+    if (bucket >= EX_MAX_REPLAY_HISTOGRAM) bucket = EX_MAX_REPLAY_HISTOGRAM - 1;
+    replay->wall_histogram[bucket] += 1;
+    replay->wall_nanoseconds += wall_nanoseconds;
+    if (wall_nanoseconds > replay->wall_max_nanoseconds) replay->wall_max_nanoseconds = wall_nanoseconds;
+    replay->frame_count += 1;
+}
@@ -0,0 +1,58 @@
+#include "exmu.h"
+#include <string.h>
+#include <algorithm>
+
+int
+EXMU_frame_stats_histogram_index(EXFRAMESTATS *stats, uint64_t delta_nanoseconds) {
+    uint64_t index = delta_nanoseconds / stats->histogram_bucket;
+    if (index >= EX_MAX_FRAME_HISTOGRAM) index = EX_MAX_FRAME_HISTOGRAM - 1;
+    return (int)index;
+}
+
+int
+EXMU_frame_stats_size(EXFRAMESTATS *stats) {
+    if (stats->count < EX_MAX_FRAME_STATS) return (int)stats->count;
+    return EX_MAX_FRAME_STATS;
+}
+
+uint64_t
+EXMU_frame_stats_get(EXFRAMESTATS *stats, int age) {
+    if (age < 0 || age >= EXMU_frame_stats_size(stats)) return 0;
+    return stats->deltas[(stats->count - 1 - age) % EX_MAX_FRAME_STATS];
+}
+
+void
+EXMU_frame_stats_push(EXFRAMESTATS *stats, uint64_t delta_nanoseconds) {
+    if (!stats->histogram_bucket) stats->histogram_bucket = 1000 * 1000;
+
+    uint64_t *slot = stats->deltas + (stats->count % EX_MAX_FRAME_STATS);
+    if (stats->count >= EX_MAX_FRAME_STATS) {
+        stats->total -= *slot;
+        stats->histogram[EXMU_frame_stats_histogram_index(stats, *slot)] -= 1;
+    }
+    *slot = delta_nanoseconds;
+    stats->total += delta_nanoseconds;
+    stats->histogram[EXMU_frame_stats_histogram_index(stats, delta_nanoseconds)] += 1;
+    stats->count += 1;
+
+    int size = EXMU_frame_stats_size(stats);
+    uint64_t sorted[EX_MAX_FRAME_STATS];
+    memcpy(sorted, stats->deltas, size * sizeof(uint64_t));
+
+    stats->min = sorted[0];
+    stats->max = sorted[0];
+    for (int index = 1; index < size; index++) {
+        if (sorted[index] < stats->min) stats->min = sorted[index];
+        if (sorted[index] > stats->max) stats->max = sorted[index];
+    }
+    stats->average = stats->total / size;
+
+    int p95_index = (size * 95) / 100;
+    int p99_index = (size * 99) / 100;
+    if (p95_index >= size) p95_index = size - 1;
+    if (p99_index >= size) p99_index = size - 1;
+    std::nth_element(sorted, sorted + p95_index, sorted + size);
+    stats->p95 = sorted[p95_index];
+    std::nth_element(sorted + p95_index, sorted + p99_index, sorted + size);
+    stats->p99 = sorted[p99_index];
+}
@@ -0,0 +1,257 @@
+#include "exmu.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void
+EXMU_stream_worker(void *data) {
+    EXSTREAM *stream = (EXSTREAM *)data;
+    uintptr_t file = 0;
+    char file_path[EX_MAX_STREAM_PATH] = "";
+    for (;;) {
+        EXMU_semaphore_wait(stream->job_semaphore, EX_TRUE);
+        if (stream->quit) break;
+        uint32_t job = stream->job_tail.fetch_add(1);
+        EXSTREAMSLOT *slot = stream->slots + stream->jobs[job % EX_MAX_STREAM_SLOTS];
+        EXSTREAMREQUEST *request = &slot->request;
+
+        EX_PROFILE_SCOPE("stream read");
+        // consecutive chunks usually come from the same pack file, keep its handle open
+        if (strcmp(file_path, request->path) != 0) {
+            if (file) EXMU_file_close(file);
+            file = 0;
+            file_path[0] = 0;
+            if (EXMU_file_open(request->path, &file)) memcpy(file_path, request->path, EX_MAX_STREAM_PATH);
+        }
+        int64_t size = file ? EXMU_file_read(file, request->offset, slot->data, request->size) : -1;
+        slot->size = size > 0 ? (uint32_t)size : 0;
+        slot->state.store(size >= 0 ? EX_STREAM_LOADED : EX_STREAM_FAILED, std::memory_order_release);
+    }
+    if (file) EXMU_file_close(file);
+}
+
+EXBOOL
+EXMU_stream_start(EXMU *state, int slot_count, uint32_t slot_capacity, int thread_count) {
+    EXSTREAM *stream = &state->stream;
+    if (stream->thread_count) return EX_TRUE;
+    if (slot_count > EX_MAX_STREAM_SLOTS) slot_count = EX_MAX_STREAM_SLOTS;
+    if (thread_count > EX_MAX_STREAM_THREADS) thread_count = EX_MAX_STREAM_THREADS;
+    if (slot_count < 1 || thread_count < 1 || !slot_capacity) {
+        state->error = "Invalid stream configuration.";
+        return EX_FALSE;
+    }
+
+    free(stream->memory);
+    stream->memory = (uint8_t *)malloc((size_t)slot_count * slot_capacity);
+    if (!stream->memory) {
+        state->error = "Failed to allocate stream slots.";
+        return EX_FALSE;
+    }
+    stream->slot_count = slot_count;
+    stream->slot_capacity = slot_capacity;
+    for (int index = 0; index < slot_count; index++) {
+        EXSTREAMSLOT *slot = stream->slots + index;
+        slot->state.store(EX_STREAM_FREE, std::memory_order_relaxed);
+        slot->released = EX_FALSE;
+        slot->data = stream->memory + (size_t)index * slot_capacity;
+        slot->size = 0;
+    }
+    stream->request_count = 0;
+    stream->job_head = 0;
+    stream->job_tail.store(0);
+    stream->quit = EX_FALSE;
+
+    stream->job_semaphore = EXMU_semaphore_create(0, EX_MAX_STREAM_SLOTS + EX_MAX_STREAM_THREADS);
+    if (stream->job_semaphore) {
+        for (int index = 0; index < thread_count; index++) {
+            stream->threads[index] = EXMU_thread_create(EXMU_stream_worker, stream);
+            if (!stream->threads[index]) break;
+            stream->thread_count += 1;
+        }
+    }
+    if (!stream->thread_count) {
+        EXMU_stream_stop(state);
+        state->error = "Failed to start stream threads.";
+        return EX_FALSE;
+    }
+    return EX_TRUE;
+}
+
+static float
+EXMU_stream_distance(EXFLOAT2 a, EXFLOAT2 b) {
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    return dx * dx + dy * dy;
+}
+
+static EXSTREAMSLOT *
+EXMU_stream_slot(EXSTREAM *stream, uint64_t key) {
+    for (int index = 0; index < stream->slot_count; index++) {
+        EXSTREAMSLOT *slot = stream->slots + index;
+        if (slot->state.load(std::memory_order_relaxed) != EX_STREAM_FREE && slot->request.key == key) return slot;
+    }
+    return 0;
+}
+
+// requesting a key that is queued or resident only moves it, the queue is reordered at the next update
+EXBOOL
+EXMU_stream_request(EXMU *state, uint64_t key, const char *path, uint64_t offset, uint32_t size, EXFLOAT2 position) {
+    EXSTREAM *stream = &state->stream;
+    if (!stream->thread_count) {
+        state->error = "Stream was not started.";
+        return EX_FALSE;
+    }
+    if (size > stream->slot_capacity) {
+        state->error = "Stream request is larger than a slot.";
+        return EX_FALSE;
+    }
+    EXSTREAMSLOT *slot = EXMU_stream_slot(stream, key);
+    if (slot) {
+        slot->request.position = position;
+        slot->released = EX_FALSE;
+        return EX_TRUE;
+    }
+    for (int index = 0; index < stream->request_count; index++) {
+        if (stream->requests[index].key != key) continue;
+        stream->requests[index].position = position;
+        return EX_TRUE;
+    }
+    if (stream->request_count == EX_MAX_STREAM_REQUESTS) {
+        state->error = "Stream request queue is full.";
+        return EX_FALSE;
+    }
+
+    EXSTREAMREQUEST *request = stream->requests + stream->request_count++;
+    request->key = key;
+    snprintf(request->path, EX_MAX_STREAM_PATH, "%s", path);
+    request->offset = offset;
+    request->size = size;
+    request->position = position;
+    stream->requested += 1;
+    return EX_TRUE;
+}
+
+// the data stays valid until the next EXMU_pull, which is the only place slots are swapped or evicted
+const void *
+EXMU_stream_find(EXMU *state, uint64_t key, uint32_t *size) {
+    EXSTREAMSLOT *slot = EXMU_stream_slot(&state->stream, key);
+    if (!slot || slot->state.load(std::memory_order_relaxed) != EX_STREAM_READY) return 0;
+    if (size) *size = slot->size;
+    return slot->data;
+}
+
+void
+EXMU_stream_release(EXMU *state, uint64_t key) {
+    EXSTREAM *stream = &state->stream;
+    for (int index = 0; index < stream->request_count; index++) {
+        if (stream->requests[index].key != key) continue;
+        stream->requests[index] = stream->requests[--stream->request_count];
+        return;
+    }
+    EXSTREAMSLOT *slot = EXMU_stream_slot(stream, key);
+    if (!slot) return;
+    if (slot->state.load(std::memory_order_relaxed) == EX_STREAM_READY) {
+        slot->state.store(EX_STREAM_FREE, std::memory_order_relaxed);
+    } else {
+        slot->released = EX_TRUE;
+    }
+}
+
+static void
+EXMU_stream_sift_down(EXSTREAM *stream, int index) {
+    EXSTREAMREQUEST *requests = stream->requests;
+    for (;;) {
+        int smallest = index;
+        int left = index * 2 + 1;
+        int right = left + 1;
+        if (left < stream->request_count && requests[left].distance < requests[smallest].distance) smallest = left;
+        if (right < stream->request_count && requests[right].distance < requests[smallest].distance) smallest = right;
+        if (smallest == index) return;
+        EXSTREAMREQUEST swap = requests[index];
+        requests[index] = requests[smallest];
+        requests[smallest] = swap;
+        index = smallest;
+    }
+}
+
+// a free slot, or the resident slot farthest from the camera if it is farther than the request
+static EXSTREAMSLOT *
+EXMU_stream_claim(EXSTREAM *stream, EXSTREAMREQUEST *request) {
+    EXSTREAMSLOT *farthest = 0;
+    float farthest_distance = request->distance;
+    for (int index = 0; index < stream->slot_count; index++) {
+        EXSTREAMSLOT *slot = stream->slots + index;
+        int slot_state = slot->state.load(std::memory_order_relaxed);
+        if (slot_state == EX_STREAM_FREE) return slot;
+        if (slot_state != EX_STREAM_READY) continue;
+        float distance = EXMU_stream_distance(slot->request.position, stream->camera);
+        if (distance > farthest_distance) {
+            farthest = slot;
+            farthest_distance = distance;
+        }
+    }
+    if (farthest) stream->evicted += 1;
+    return farthest;
+}
+
+// runs at the frame boundary and never waits, reads only ever happen on the workers
+void
+EXMU_stream_update(EXMU *state) {
+    EXSTREAM *stream = &state->stream;
+    if (!stream->thread_count) return;
+    EX_PROFILE_SCOPE("stream");
+    stream->frame += 1;
+
+    // SWAP
+    for (int index = 0; index < stream->slot_count; index++) {
+        EXSTREAMSLOT *slot = stream->slots + index;
+        int slot_state = slot->state.load(std::memory_order_acquire);
+        if (slot_state == EX_STREAM_LOADED) {
+            stream->loaded += 1;
+            stream->bytes += slot->size;
+            slot->frame = stream->frame;
+            slot->state.store(slot->released ? EX_STREAM_FREE : EX_STREAM_READY, std::memory_order_relaxed);
+        } else if (slot_state == EX_STREAM_FAILED) {
+            stream->failed += 1;
+            slot->state.store(EX_STREAM_FREE, std::memory_order_relaxed);
+        }
+    }
+
+    // ORDER
+    for (int index = 0; index < stream->request_count; index++) {
+        EXSTREAMREQUEST *request = stream->requests + index;
+        request->distance = EXMU_stream_distance(request->position, stream->camera);
+    }
+    for (int index = stream->request_count / 2 - 1; index >= 0; index--) EXMU_stream_sift_down(stream, index);
+
+    // DISPATCH
+    while (stream->request_count) {
+        EXSTREAMSLOT *slot = EXMU_stream_claim(stream, stream->requests);
+        if (!slot) break;
+        slot->request = stream->requests[0];
+        slot->released = EX_FALSE;
+        slot->size = 0;
+        stream->requests[0] = stream->requests[--stream->request_count];
+        EXMU_stream_sift_down(stream, 0);
+
+        slot->state.store(EX_STREAM_LOADING, std::memory_order_relaxed);
+        stream->jobs[stream->job_head % EX_MAX_STREAM_SLOTS] = (int)(slot - stream->slots);
+        stream->job_head += 1;
+        EXMU_semaphore_signal(stream->job_semaphore);
+    }
+}
+
+// waits for reads in flight, so it belongs at shutdown rather than in a frame
+void
+EXMU_stream_stop(EXMU *state) {
+    EXSTREAM *stream = &state->stream;
+    stream->quit = EX_TRUE;
+    for (int index = 0; index < stream->thread_count; index++) EXMU_semaphore_signal(stream->job_semaphore);
+    for (int index = 0; index < stream->thread_count; index++) EXMU_thread_join(stream->threads[index]);
+    stream->thread_count = 0;
+    EXMU_semaphore_destroy(stream->job_semaphore);
+    stream->job_semaphore = 0;
+    free(stream->memory);
+    stream->memory = 0;
+    stream->slot_count = 0;
+    stream->request_count = 0;
+}
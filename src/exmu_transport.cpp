@@ -0,0 +1,109 @@
+#include "exmu.h"
+#include <stdlib.h>
+#include <string.h>
+
+EXBOOL
+EXMU_address_parse(EXADDRESS *address, const char *text) {
+    unsigned int a, b, c, d, port;
+    if (sscanf(text, "%u.%u.%u.%u:%u", &a, &b, &c, &d, &port) != 5) return EX_FALSE;
+    if (a > 255 || b > 255 || c > 255 || d > 255 || port > 65535) return EX_FALSE;
+    address->host = a << 24 | b << 16 | c << 8 | d;
+    address->port = (uint16_t)port;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_transport_loopback(EXTRANSPORT *a, EXTRANSPORT *b) {
+    EXLOOPBACK *loopback = (EXLOOPBACK *)calloc(1, sizeof(EXLOOPBACK));
+    if (!loopback) return EX_FALSE;
+    loopback->references = 2;
+    memset(a, 0, sizeof(EXTRANSPORT));
+    memset(b, 0, sizeof(EXTRANSPORT));
+    a->type = EX_TRANSPORT_LOOPBACK;
+    a->address.port = 1;
+    a->loopback = loopback;
+    a->loopback_side = 0;
+    b->type = EX_TRANSPORT_LOOPBACK;
+    b->address.port = 2;
+    b->loopback = loopback;
+    b->loopback_side = 1;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_transport_udp(EXTRANSPORT *transport, uint16_t port) {
+    memset(transport, 0, sizeof(EXTRANSPORT));
+    if (!EXMU_udp_open(&transport->socket, port)) return EX_FALSE;
+    transport->type = EX_TRANSPORT_UDP;
+    transport->address.port = port;
+    return EX_TRUE;
+}
+
+// a full loopback queue drops the packet like a congested link would
+EXBOOL
+EXMU_transport_send(EXTRANSPORT *transport, EXADDRESS address, const void *data, int size) {
+    if (size > EX_MAX_PACKET_SIZE) return EX_FALSE;
+    EXBOOL sent = EX_FALSE;
+    if (transport->type == EX_TRANSPORT_LOOPBACK) {
+        EXLOOPBACKQUEUE *queue = transport->loopback->queues + (transport->loopback_side ^ 1);
+        if (queue->head - queue->tail < EX_MAX_LOOPBACK_PACKETS) {
+            EXPACKET *packet = queue->packets + (queue->head % EX_MAX_LOOPBACK_PACKETS);
+            packet->address = transport->address;
+            packet->size = size;
+            memcpy(packet->data, data, size);
+            queue->head += 1;
+            sent = EX_TRUE;
+        }
+    } else if (transport->type == EX_TRANSPORT_UDP) {
+        sent = EXMU_udp_send(transport->socket, address, data, size);
+    }
+    if (!sent) {
+        transport->packets_dropped += 1;
+        return EX_FALSE;
+    }
+    transport->packets_sent += 1;
+    transport->bytes_sent += size;
+    return EX_TRUE;
+}
+
+// returns the packet size, or 0 when nothing is pending
+int
+EXMU_transport_receive(EXTRANSPORT *transport, EXADDRESS *address, void *data, int capacity) {
+    int size = 0;
+    if (transport->type == EX_TRANSPORT_LOOPBACK) {
+        EXLOOPBACKQUEUE *queue = transport->loopback->queues + transport->loopback_side;
+        while (queue->tail != queue->head) {
+            EXPACKET *packet = queue->packets + (queue->tail % EX_MAX_LOOPBACK_PACKETS);
+            queue->tail += 1;
+            // dropped like an oversized datagram, the packets behind it are still delivered
+            if (packet->size > capacity) {
+                transport->packets_dropped += 1;
+                continue;
+            }
+            *address = packet->address;
+            memcpy(data, packet->data, packet->size);
+            size = packet->size;
+            break;
+        }
+    } else if (transport->type == EX_TRANSPORT_UDP) {
+        size = EXMU_udp_receive(transport->socket, address, data, capacity);
+    }
+    if (size > 0) {
+        transport->packets_received += 1;
+        transport->bytes_received += size;
+    }
+    return size;
+}
+
+void
+EXMU_transport_close(EXTRANSPORT *transport) {
+    if (transport->type == EX_TRANSPORT_LOOPBACK) {
+        transport->loopback->references -= 1;
+        if (!transport->loopback->references) free(transport->loopback);
+    } else if (transport->type == EX_TRANSPORT_UDP) {
+        EXMU_udp_close(transport->socket);
+    }
+    transport->type = EX_TRANSPORT_NONE;
+    transport->loopback = 0;
+    transport->socket = 0;
+}
@@ -4,8 +4,10 @@
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
+#include <winsock2.h>
 #include <windows.h>
 #include <xinput.h>
+#include <gl/gl.h>
 
 #ifdef _DEBUG
 #define EX_ASSERT(x) \
@@ -14,8 +16,76 @@
 #define EX_ASSERT(x)
 #endif
 
-X_INPUT_GET_STATE(xinput_get_state_) { return 0; }
-X_INPUT_SET_STATE(xinput_set_state_) { return 0; }
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+typedef char GLchar;
+typedef uint64_t GLuint64;
+typedef struct __GLsync *GLsync;
+
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_WAIT_FAILED 0x911D
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#define EX_GL_FENCE_TIMEOUT 1000000000ull
+
+#define EX_GL_PROCS(X) \
+    X(void, glGenBuffers, (GLsizei n, GLuint *buffers)) \
+    X(void, glDeleteBuffers, (GLsizei n, const GLuint *buffers)) \
+    X(void, glBindBuffer, (GLenum target, GLuint buffer)) \
+    X(void, glBufferStorage, (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)) \
+    X(void *, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)) \
+    X(GLboolean, glUnmapBuffer, (GLenum target)) \
+    X(GLsync, glFenceSync, (GLenum condition, GLbitfield flags)) \
+    X(GLenum, glClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout)) \
+    X(void, glDeleteSync, (GLsync sync)) \
+    X(GLuint, glCreateShader, (GLenum type)) \
+    X(void, glShaderSource, (GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)) \
+    X(void, glCompileShader, (GLuint shader)) \
+    X(void, glGetShaderiv, (GLuint shader, GLenum pname, GLint *params)) \
+    X(void, glDeleteShader, (GLuint shader)) \
+    X(GLuint, glCreateProgram, (void)) \
+    X(void, glAttachShader, (GLuint program, GLuint shader)) \
+    X(void, glLinkProgram, (GLuint program)) \
+    X(void, glGetProgramiv, (GLuint program, GLenum pname, GLint *params)) \
+    X(void, glUseProgram, (GLuint program)) \
+    X(void, glGenVertexArrays, (GLsizei n, GLuint *arrays)) \
+    X(void, glBindVertexArray, (GLuint array))
+
+#define EX_GL_DECLARE(type, name, args) \
+    typedef type APIENTRY EX_##name##_PROC args; \
+    static EX_##name##_PROC *ex_##name;
+EX_GL_PROCS(EX_GL_DECLARE)
+#undef EX_GL_DECLARE
+
+// one triangle covering the viewport, row 0 of the framebuffer at the top
+static const char *ex_gl_vertex_shader =
+    "#version 330\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    uv = vec2(position.x, 1.0 - position.y);\n"
+    "    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *ex_gl_fragment_shader =
+    "#version 330\n"
+    "uniform sampler2D framebuffer;\n"
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    color = texture(framebuffer, uv);\n"
+    "}\n";
+
+X_INPUT_GET_STATE(xinput_get_state_) { return ERROR_DEVICE_NOT_CONNECTED; }
+X_INPUT_SET_STATE(xinput_set_state_) { return ERROR_DEVICE_NOT_CONNECTED; }
 
 void
 EXMU_exit_with_error(EXMU *state) {
@@ -92,15 +162,29 @@ void
 EXMU_time_pull(EXMU *state) {
     LARGE_INTEGER large_integer;
     QueryPerformanceCounter(&large_integer);
-    uint64_t current_ticks = large_integer.QuadPart;
+    uint64_t current_ticks = large_integer.QuadPart - state->time.initial_ticks;
+
+    uint64_t wall_delta_ticks = current_ticks - state->time.wall_ticks;
+    state->time.wall_ticks = current_ticks;
+    state->time.wall_delta_nanoseconds = (1000 * 1000 * 1000 * wall_delta_ticks) / state->time.ticks_per_second;
+
+    // playback feeds the recorded delta back unchanged, in the recording's frequency, so the deltas
+    // match the recording exactly and only the running clock is converted to this machine's ticks
+    uint64_t delta_ticks = current_ticks - state->time.ticks;
+    uint64_t ticks_per_second = state->time.ticks_per_second;
+    if (state->replay.mode == EX_REPLAY_PLAYBACK) {
+        delta_ticks = state->replay.frame.delta_ticks;
+        ticks_per_second = state->replay.ticks_per_second;
+        current_ticks = state->time.ticks + (delta_ticks * state->time.ticks_per_second) / ticks_per_second;
+    }
     
-    state->time.delta_ticks = current_ticks - state->time.ticks - state->time.initial_ticks;
-    state->time.ticks = current_ticks - state->time.initial_ticks;
+    state->time.delta_ticks = delta_ticks;
+    state->time.ticks = current_ticks;
 
-    state->time.delta_nanoseconds = (1000 * 1000 * 1000 * state->time.delta_ticks) / state->time.ticks_per_second;
+    state->time.delta_nanoseconds = (1000 * 1000 * 1000 * delta_ticks) / ticks_per_second;
     state->time.delta_microseconds = state->time.delta_nanoseconds / 1000;
     state->time.delta_milliseconds = state->time.delta_microseconds / 1000;
-    state->time.delta_seconds = (float)state->time.delta_ticks / (float)state->time.ticks_per_second;
+    state->time.delta_seconds = (float)delta_ticks / (float)ticks_per_second;
     
     state->time.nanoseconds = (1000 * 1000 * 1000 * state->time.ticks) / state->time.ticks_per_second;
     state->time.microseconds = state->time.nanoseconds / 1000;
@@ -129,38 +213,87 @@ EXMU_mouse_pull(EXMU *state) {
     state->mouse.position.y = mouse_position.y;
 }
 
+void
+EXMU_gamepad_decode(EXGAMEPAD *gamepad, XINPUT_STATE *xinput_state) {
+    EXMU_update_digital_button(&gamepad->up_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_UP) == XINPUT_GAMEPAD_DPAD_UP);
+    EXMU_update_digital_button(&gamepad->down_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_DOWN) == XINPUT_GAMEPAD_DPAD_DOWN);
+    EXMU_update_digital_button(&gamepad->left_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_LEFT) == XINPUT_GAMEPAD_DPAD_LEFT);
+    EXMU_update_digital_button(&gamepad->right_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_RIGHT) == XINPUT_GAMEPAD_DPAD_RIGHT);
+    EXMU_update_digital_button(&gamepad->start_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_START) == XINPUT_GAMEPAD_START);
+    EXMU_update_digital_button(&gamepad->back_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_BACK) == XINPUT_GAMEPAD_BACK);
+    EXMU_update_digital_button(&gamepad->left_thumb_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_THUMB) == XINPUT_GAMEPAD_LEFT_THUMB);
+    EXMU_update_digital_button(&gamepad->right_thumb_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_THUMB) == XINPUT_GAMEPAD_RIGHT_THUMB);
+    EXMU_update_digital_button(&gamepad->left_shoulder_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER) == XINPUT_GAMEPAD_LEFT_SHOULDER);
+    EXMU_update_digital_button(&gamepad->right_shoulder_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER) == XINPUT_GAMEPAD_RIGHT_SHOULDER);
+    EXMU_update_digital_button(&gamepad->a_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_A) == XINPUT_GAMEPAD_A);
+    EXMU_update_digital_button(&gamepad->b_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_B) == XINPUT_GAMEPAD_B);
+    EXMU_update_digital_button(&gamepad->x_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_X) == XINPUT_GAMEPAD_X);
+    EXMU_update_digital_button(&gamepad->y_button, (xinput_state->Gamepad.wButtons & XINPUT_GAMEPAD_Y) == XINPUT_GAMEPAD_Y);
+    EXMU_update_analog_button(&gamepad->left_trigger, xinput_state->Gamepad.bLeftTrigger / 255.0f);
+    EXMU_update_analog_button(&gamepad->right_trigger, xinput_state->Gamepad.bRightTrigger / 255.0f);
+#define CONVERT(x) (2.0f * (((x + 32768) / 65535.0f) - 0.5f))
+    EXMU_update_stick(&gamepad->left_thumb_stick, CONVERT(xinput_state->Gamepad.sThumbLX), CONVERT(xinput_state->Gamepad.sThumbLY));
+    EXMU_update_stick(&gamepad->right_thumb_stick, CONVERT(xinput_state->Gamepad.sThumbRX), CONVERT(xinput_state->Gamepad.sThumbRY));
+#undef CONVERT
+}
+
+void
+EXMU_gamepad_hold(EXGAMEPAD *gamepad) {
+    EXDIGITALBUTTON *buttons[] = {
+        &gamepad->up_button, &gamepad->down_button, &gamepad->left_button, &gamepad->right_button,
+        &gamepad->start_button, &gamepad->back_button, &gamepad->left_thumb_button, &gamepad->right_thumb_button,
+        &gamepad->left_shoulder_button, &gamepad->right_shoulder_button,
+        &gamepad->a_button, &gamepad->b_button, &gamepad->x_button, &gamepad->y_button,
+    };
+    for (EXDIGITALBUTTON *button : buttons) EXMU_update_digital_button(button, button->down);
+    EXMU_update_analog_button(&gamepad->left_trigger, gamepad->left_trigger.value);
+    EXMU_update_analog_button(&gamepad->right_trigger, gamepad->right_trigger.value);
+}
+
 void
 EXMU_gamepad_pull(EXMU *state) {
     if (!state->win32.xinput_get_state) return;
 
-    XINPUT_STATE xinput_state = {};
-    if (state->win32.xinput_get_state(0, &xinput_state) == ERROR_DEVICE_NOT_CONNECTED) {
-        state->gamepad.connected = EX_FALSE;
-        return;
-    }
-
-    state->gamepad.connected = EX_TRUE;
+    uint64_t min_poll_interval = state->time.ticks_per_second / 4;
+    uint64_t max_poll_interval = state->time.ticks_per_second * 2;
+    uint64_t ticks = state->time.wall_ticks;
     
-    EXMU_update_digital_button(&state->gamepad.up_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_UP) == XINPUT_GAMEPAD_DPAD_UP);
-    EXMU_update_digital_button(&state->gamepad.down_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_DOWN) == XINPUT_GAMEPAD_DPAD_DOWN);
-    EXMU_update_digital_button(&state->gamepad.left_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_LEFT) == XINPUT_GAMEPAD_DPAD_LEFT);
-    EXMU_update_digital_button(&state->gamepad.right_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_RIGHT) == XINPUT_GAMEPAD_DPAD_RIGHT);
-    EXMU_update_digital_button(&state->gamepad.start_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_START) == XINPUT_GAMEPAD_START);
-    EXMU_update_digital_button(&state->gamepad.back_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_BACK) == XINPUT_GAMEPAD_BACK);
-    EXMU_update_digital_button(&state->gamepad.left_thumb_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_THUMB) == XINPUT_GAMEPAD_LEFT_THUMB);
-    EXMU_update_digital_button(&state->gamepad.right_thumb_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_THUMB) == XINPUT_GAMEPAD_RIGHT_THUMB);
-    EXMU_update_digital_button(&state->gamepad.left_shoulder_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER) == XINPUT_GAMEPAD_LEFT_SHOULDER);
-    EXMU_update_digital_button(&state->gamepad.right_shoulder_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER) == XINPUT_GAMEPAD_RIGHT_SHOULDER);
-    EXMU_update_digital_button(&state->gamepad.a_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_A) == XINPUT_GAMEPAD_A);
-    EXMU_update_digital_button(&state->gamepad.b_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_B) == XINPUT_GAMEPAD_B);
-    EXMU_update_digital_button(&state->gamepad.x_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_X) == XINPUT_GAMEPAD_X);
-    EXMU_update_digital_button(&state->gamepad.y_button, (xinput_state.Gamepad.wButtons & XINPUT_GAMEPAD_Y) == XINPUT_GAMEPAD_Y);
-    EXMU_update_analog_button(&state->gamepad.left_trigger, xinput_state.Gamepad.bLeftTrigger / 255.0f);
-    EXMU_update_analog_button(&state->gamepad.right_trigger, xinput_state.Gamepad.bRightTrigger / 255.0f);
-#define CONVERT(x) (2.0f * (((x + 32768) / 65535.0f) - 0.5f))
-    EXMU_update_stick(&state->gamepad.left_thumb_stick, CONVERT(xinput_state.Gamepad.sThumbLX), CONVERT(xinput_state.Gamepad.sThumbLY));
-    EXMU_update_stick(&state->gamepad.right_thumb_stick, CONVERT(xinput_state.Gamepad.sThumbRX), CONVERT(xinput_state.Gamepad.sThumbRY));
-#undef CONVERT
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        EXGAMEPAD *gamepad = state->gamepads + index;
+        EXWIN32GAMEPAD *slot = state->win32.gamepads + index;
+        
+        if (!gamepad->connected && ticks < slot->next_poll_ticks) {
+            EXMU_gamepad_hold(gamepad);
+            continue;
+        }
+
+        XINPUT_STATE xinput_state = {};
+        if (state->win32.xinput_get_state(index, &xinput_state) != ERROR_SUCCESS) {
+            if (gamepad->connected) {
+                XINPUT_STATE released_state = {};
+                EXMU_gamepad_decode(gamepad, &released_state);
+                gamepad->connected = EX_FALSE;
+                slot->vibration_written = EX_FALSE;
+            } else {
+                EXMU_gamepad_hold(gamepad);
+            }
+            if (slot->poll_interval_ticks < min_poll_interval) slot->poll_interval_ticks = min_poll_interval;
+            else if (slot->poll_interval_ticks < max_poll_interval) slot->poll_interval_ticks *= 2;
+            if (slot->poll_interval_ticks > max_poll_interval) slot->poll_interval_ticks = max_poll_interval;
+            slot->next_poll_ticks = ticks + slot->poll_interval_ticks;
+            continue;
+        }
+
+        slot->poll_interval_ticks = 0;
+        if (gamepad->connected && xinput_state.dwPacketNumber == slot->packet_number) {
+            EXMU_gamepad_hold(gamepad);
+            continue;
+        }
+        
+        gamepad->connected = EX_TRUE;
+        slot->packet_number = xinput_state.dwPacketNumber;
+        EXMU_gamepad_decode(gamepad, &xinput_state);
+    }
 }
 
 EXBOOL
@@ -170,27 +303,191 @@ EXMU_pull(EXMU *state) {
         EXMU_exit_with_error(state);
         return EX_FALSE;
     }    
-    EXMU_window_pull(state);
+    if (!state->headless) EXMU_window_pull(state);
+    EXMU_replay_read(state);
     EXMU_time_pull(state);
-    EXMU_keyboard_pull(state);
-    EXMU_mouse_pull(state);
-    EXMU_gamepad_pull(state);
+    EXMU_profile_frame(state);
+    EXMU_stream_update(state);
+    EXMU_frame_stats_push(&state->frame_stats, state->time.wall_delta_nanoseconds);
+    if (state->replay.mode == EX_REPLAY_PLAYBACK) {
+        EXMU_replay_apply(state);
+    } else {
+        EXMU_keyboard_pull(state);
+        EXMU_mouse_pull(state);
+        EXMU_gamepad_pull(state);
+        EXMU_replay_write(state);
+    }
     return !state->quit;
 }
 
 void
 EXMU_gamepad_push(EXMU *state) {
-    uint16_t left_motor_speed = state->gamepad.left_motor_speed * UINT16_MAX;
-    uint16_t right_motor_speed = state->gamepad.right_motor_speed * UINT16_MAX;
-    
-    XINPUT_VIBRATION xinput_vibration;
-    xinput_vibration.wLeftMotorSpeed = left_motor_speed;
-    xinput_vibration.wRightMotorSpeed = right_motor_speed;
-    state->win32.xinput_set_state(0, &xinput_vibration);
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        EXGAMEPAD *gamepad = state->gamepads + index;
+        EXWIN32GAMEPAD *slot = state->win32.gamepads + index;
+        if (!gamepad->connected) continue;
+        
+        uint16_t left_motor_speed = gamepad->left_motor_speed * UINT16_MAX;
+        uint16_t right_motor_speed = gamepad->right_motor_speed * UINT16_MAX;
+        if (slot->vibration_written &&
+            slot->left_motor_speed == left_motor_speed &&
+            slot->right_motor_speed == right_motor_speed) continue;
+        
+        XINPUT_VIBRATION xinput_vibration;
+        xinput_vibration.wLeftMotorSpeed = left_motor_speed;
+        xinput_vibration.wRightMotorSpeed = right_motor_speed;
+        if (state->win32.xinput_set_state(index, &xinput_vibration) == ERROR_SUCCESS) {
+            slot->left_motor_speed = left_motor_speed;
+            slot->right_motor_speed = right_motor_speed;
+            slot->vibration_written = EX_TRUE;
+        }
+    }
+}
+
+void
+EXMU_opengl_texture(EXMU *state, const void *pixels) {
+    EXFRAMEBUFFER *framebuffer = &state->framebuffer;
+    if (!state->win32.framebuffer_texture) {
+        glGenTextures(1, &state->win32.framebuffer_texture);
+        glBindTexture(GL_TEXTURE_2D, state->win32.framebuffer_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    }
+    glBindTexture(GL_TEXTURE_2D, state->win32.framebuffer_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (state->win32.framebuffer_texture_size.x != framebuffer->width ||
+        state->win32.framebuffer_texture_size.y != framebuffer->height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, framebuffer->width, framebuffer->height, 0,
+                     GL_BGRA_EXT, GL_UNSIGNED_BYTE, pixels);
+        state->win32.framebuffer_texture_size.x = framebuffer->width;
+        state->win32.framebuffer_texture_size.y = framebuffer->height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, framebuffer->width, framebuffer->height,
+                        GL_BGRA_EXT, GL_UNSIGNED_BYTE, pixels);
+    }
+}
+
+void
+EXMU_opengl_legacy_push(EXMU *state) {
+    EXFRAMEBUFFER *framebuffer = &state->framebuffer;
+    {
+        EX_PROFILE_SCOPE("expand");
+        EXMU_framebuffer_expand(framebuffer, framebuffer->pixels);
+    }
+    EXMU_opengl_texture(state, framebuffer->pixels);
+
+    glViewport(0, 0, state->window.size.x, state->window.size.y);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glEnable(GL_TEXTURE_2D);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(-1.0f, 1.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(1.0f, 1.0f); glVertex2f(1.0f, -1.0f);
+    glTexCoord2f(0.0f, 1.0f); glVertex2f(-1.0f, -1.0f);
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
+}
+
+// a caller that can skip the buffer only polls and keeps a fence that has not signalled, a blocking
+// caller waits up to EX_GL_FENCE_TIMEOUT and then glFinish stands in for it, as it also does when the
+// driver fails the wait
+static EXBOOL
+EXMU_opengl_fence_wait(EXWIN32 *win32, int index, EXBOOL block) {
+    GLsync fence = (GLsync)win32->pixel_buffer_fences[index];
+    if (!fence) return EX_TRUE;
+    GLenum result = ex_glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, block ? EX_GL_FENCE_TIMEOUT : 0);
+    if (result == GL_TIMEOUT_EXPIRED && !block) return EX_FALSE;
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) glFinish();
+    ex_glDeleteSync(fence);
+    win32->pixel_buffer_fences[index] = 0;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_opengl_reserve(EXMU *state, int capacity) {
+    EXWIN32 *win32 = &state->win32;
+    if (capacity <= win32->pixel_buffer_capacity) return EX_TRUE;
+
+    for (int index = 0; index < EX_MAX_PIXEL_BUFFERS; index++) EXMU_opengl_fence_wait(win32, index, EX_TRUE);
+    if (win32->pixel_buffer) {
+        ex_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, win32->pixel_buffer);
+        ex_glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        ex_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ex_glDeleteBuffers(1, &win32->pixel_buffer);
+        win32->pixel_buffer = 0;
+        win32->pixel_buffer_memory = 0;
+        win32->pixel_buffer_capacity = 0;
+    }
+
+    // immutable storage stays mapped for the lifetime of the buffer
+    GLsizeiptr size = (GLsizeiptr)capacity * sizeof(uint32_t) * EX_MAX_PIXEL_BUFFERS;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    ex_glGenBuffers(1, &win32->pixel_buffer);
+    ex_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, win32->pixel_buffer);
+    ex_glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, 0, flags);
+    win32->pixel_buffer_memory = (uint8_t *)ex_glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    ex_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!win32->pixel_buffer_memory) {
+        ex_glDeleteBuffers(1, &win32->pixel_buffer);
+        win32->pixel_buffer = 0;
+        return EX_FALSE;
+    }
+    win32->pixel_buffer_capacity = capacity;
+    return EX_TRUE;
+}
+
+void
+EXMU_opengl_modern_push(EXMU *state) {
+    EXWIN32 *win32 = &state->win32;
+    EXFRAMEBUFFER *framebuffer = &state->framebuffer;
+    int capacity = state->window.size.x * state->window.size.y;
+    if (capacity < framebuffer->capacity) capacity = framebuffer->capacity;
+    if (!EXMU_opengl_reserve(state, capacity)) {
+        win32->modern_opengl = EX_FALSE;
+        EXMU_opengl_legacy_push(state);
+        return;
+    }
+
+    int index = win32->pixel_buffer_index;
+    win32->pixel_buffer_index = (index + 1) % EX_MAX_PIXEL_BUFFERS;
+    EXBOOL upload;
+    {
+        EX_PROFILE_SCOPE("fence");
+        upload = EXMU_opengl_fence_wait(win32, index, EX_FALSE);
+    }
+
+    // the GPU still owns the buffer, so this frame's upload is dropped and the last texture drawn again
+    if (upload) {
+        size_t offset = (size_t)index * win32->pixel_buffer_capacity * sizeof(uint32_t);
+        {
+            EX_PROFILE_SCOPE("expand");
+            EXMU_framebuffer_expand(framebuffer, (uint32_t *)(win32->pixel_buffer_memory + offset));
+        }
+        ex_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, win32->pixel_buffer);
+        EXMU_opengl_texture(state, (const void *)offset);
+        ex_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glViewport(0, 0, state->window.size.x, state->window.size.y);
+    ex_glUseProgram(win32->program);
+    ex_glBindVertexArray(win32->vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    ex_glBindVertexArray(0);
+    ex_glUseProgram(0);
+    if (upload) win32->pixel_buffer_fences[index] = ex_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 void
 EXMU_opengl_push(EXMU *state) {
+    if (state->framebuffer.pixels) {
+        if (state->win32.modern_opengl) EXMU_opengl_modern_push(state);
+        else EXMU_opengl_legacy_push(state);
+    }
     SwapBuffers(state->win32.device_context);
 }
 
@@ -201,11 +498,259 @@ EXMU_push(EXMU *state) {
         EXMU_exit_with_error(state);
         return EX_FALSE;
     }
+    
+    LARGE_INTEGER large_integer;
+    QueryPerformanceCounter(&large_integer);
+    uint64_t work_ticks = large_integer.QuadPart - state->time.initial_ticks - state->time.wall_ticks;
+    state->time.work_nanoseconds = (1000 * 1000 * 1000 * work_ticks) / state->time.ticks_per_second;
+    
+    EXMU_capture_frame(state);
+    if (state->headless) return !state->quit;
     EXMU_gamepad_push(state);
     EXMU_opengl_push(state);
     return !state->quit;
 }
 
+struct EXWIN32THREAD {
+    EXTHREADPROC *proc;
+    void *data;
+};
+
+DWORD WINAPI
+EXMU_win32_thread_proc(LPVOID parameter) {
+    EXWIN32THREAD thread = *(EXWIN32THREAD *)parameter;
+    free(parameter);
+    thread.proc(thread.data);
+    EXMU_profile_thread_exit();
+    EXMU_counters_close();
+    return 0;
+}
+
+void *
+EXMU_thread_create(EXTHREADPROC *proc, void *data) {
+    EXWIN32THREAD *thread = (EXWIN32THREAD *)malloc(sizeof(EXWIN32THREAD));
+    if (!thread) return 0;
+    thread->proc = proc;
+    thread->data = data;
+    HANDLE handle = CreateThread(0, 0, EXMU_win32_thread_proc, thread, 0, 0);
+    if (!handle) free(thread);
+    return handle;
+}
+
+void
+EXMU_thread_join(void *thread) {
+    if (!thread) return;
+    WaitForSingleObject((HANDLE)thread, INFINITE);
+    CloseHandle((HANDLE)thread);
+}
+
+// pins the calling thread
+EXBOOL
+EXMU_thread_pin(int cpu) {
+    if (cpu < 0 || cpu >= 64) return EX_FALSE;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+}
+
+int
+EXMU_cpu_count(void) {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return (int)system_info.dwNumberOfProcessors;
+}
+
+uint64_t
+EXMU_nanoseconds(void) {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+    uint64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000ull + remainder * 1000000000ull / frequency.QuadPart;
+}
+
+void
+EXMU_sleep(uint32_t milliseconds) {
+    Sleep(milliseconds);
+}
+
+void *
+EXMU_semaphore_create(int initial_count, int maximum_count) {
+    return CreateSemaphoreA(0, initial_count, maximum_count, 0);
+}
+
+void
+EXMU_semaphore_destroy(void *semaphore) {
+    if (semaphore) CloseHandle((HANDLE)semaphore);
+}
+
+void
+EXMU_semaphore_signal(void *semaphore) {
+    ReleaseSemaphore((HANDLE)semaphore, 1, 0);
+}
+
+EXBOOL
+EXMU_semaphore_wait(void *semaphore, EXBOOL block) {
+    return WaitForSingleObject((HANDLE)semaphore, block ? INFINITE : 0) == WAIT_OBJECT_0;
+}
+
+EXBOOL
+EXMU_file_open(const char *path, uintptr_t *file) {
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+    if (handle == INVALID_HANDLE_VALUE) return EX_FALSE;
+    *file = (uintptr_t)handle;
+    return EX_TRUE;
+}
+
+// positional like pread, so workers can share a handle without seeking
+int64_t
+EXMU_file_read(uintptr_t file, uint64_t offset, void *data, uint32_t size) {
+    uint32_t total = 0;
+    while (total < size) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = (DWORD)(offset + total);
+        overlapped.OffsetHigh = (DWORD)((offset + total) >> 32);
+        DWORD read = 0;
+        if (!ReadFile((HANDLE)file, (uint8_t *)data + total, size - total, &read, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) break;
+            return -1;
+        }
+        if (!read) break;
+        total += read;
+    }
+    return total;
+}
+
+void
+EXMU_file_close(uintptr_t file) {
+    CloseHandle((HANDLE)file);
+}
+
+static uint64_t
+EXMU_module_write_time(const char *path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return 0;
+    return ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+// copies left by earlier runs, ones still mapped by another running process fail to delete and are kept
+static void
+EXMU_module_clean(const char *path) {
+    char pattern[EX_MAX_MODULE_PATH + 16];
+    snprintf(pattern, sizeof(pattern), "%s.*.tmp", path);
+    int directory_length = 0;
+    for (int index = 0; path[index]; index++) {
+        if (path[index] == '/' || path[index] == '\\') directory_length = index + 1;
+    }
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        char copy_path[EX_MAX_MODULE_PATH + MAX_PATH];
+        snprintf(copy_path, sizeof(copy_path), "%.*s%s", directory_length, path, data.cFileName);
+        DeleteFileA(copy_path);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+}
+
+// loads a numbered copy so the linker can overwrite the original while it runs, earlier copies
+// stay mapped because profile events recorded from them still point at their scope names
+EXBOOL
+EXMU_module_load(EXMU *state, EXMODULE *module, const char *path) {
+    if (path != module->path) snprintf(module->path, EX_MAX_MODULE_PATH, "%s", path);
+    if (!module->version) EXMU_module_clean(module->path);
+    module->write_time = EXMU_module_write_time(module->path);
+    char copy_path[EX_MAX_MODULE_PATH + 16];
+    snprintf(copy_path, sizeof(copy_path), "%s.%d.tmp", module->path, module->version);
+    if (!module->write_time || !CopyFileA(module->path, copy_path, FALSE)) {
+        state->error = "Failed to copy module.";
+        return EX_FALSE;
+    }
+    HMODULE library = LoadLibraryA(copy_path);
+    if (!library) {
+        state->error = "Failed to load module.";
+        return EX_FALSE;
+    }
+    module->library = library;
+    module->version += 1;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_module_changed(EXMODULE *module) {
+    uint64_t write_time = EXMU_module_write_time(module->path);
+    return write_time && write_time != module->write_time;
+}
+
+void *
+EXMU_module_symbol(EXMODULE *module, const char *name) {
+    if (!module->library) return 0;
+    return (void *)GetProcAddress((HMODULE)module->library, name);
+}
+
+static EXBOOL
+EXMU_win32_winsock(void) {
+    static EXBOOL started;
+    if (started) return EX_TRUE;
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return EX_FALSE;
+    started = EX_TRUE;
+    return EX_TRUE;
+}
+
+EXBOOL
+EXMU_udp_open(uintptr_t *socket_handle, uint16_t port) {
+    if (!EXMU_win32_winsock()) return EX_FALSE;
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == INVALID_SOCKET) return EX_FALSE;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    u_long non_blocking = 1;
+    if (bind(handle, (sockaddr *)&address, sizeof(address)) == SOCKET_ERROR ||
+        ioctlsocket(handle, FIONBIO, &non_blocking) == SOCKET_ERROR) {
+        closesocket(handle);
+        return EX_FALSE;
+    }
+    *socket_handle = (uintptr_t)handle;
+    return EX_TRUE;
+}
+
+void
+EXMU_udp_close(uintptr_t socket_handle) {
+    closesocket((SOCKET)socket_handle);
+}
+
+EXBOOL
+EXMU_udp_send(uintptr_t socket_handle, EXADDRESS address, const void *data, int size) {
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(address.host);
+    to.sin_port = htons(address.port);
+    return sendto((SOCKET)socket_handle, (const char *)data, size, 0, (sockaddr *)&to, sizeof(to)) == size;
+}
+
+// an ICMP port unreachable from an earlier send surfaces as WSAECONNRESET, skip past it
+int
+EXMU_udp_receive(uintptr_t socket_handle, EXADDRESS *address, void *data, int capacity) {
+    for (;;) {
+        sockaddr_in from = {};
+        int from_size = sizeof(from);
+        int size = recvfrom((SOCKET)socket_handle, (char *)data, capacity, 0, (sockaddr *)&from, &from_size);
+        if (size == SOCKET_ERROR) {
+            // a datagram larger than the buffer is discarded by the stack, the next one is still pending
+            int error = WSAGetLastError();
+            if (error == WSAECONNRESET || error == WSAEMSGSIZE) continue;
+            return 0;
+        }
+        address->host = ntohl(from.sin_addr.s_addr);
+        address->port = ntohs(from.sin_port);
+        return size;
+    }
+}
+
 LRESULT CALLBACK
 EXMU_win32_window_proc(HWND window, UINT message, WPARAM wparam, LPARAM lparam) {
     LRESULT result = 0;
@@ -384,10 +929,59 @@ EXMU_gamepad_initialize(EXMU *state) {
     }
     
     float trigger_threshold = XINPUT_GAMEPAD_TRIGGER_THRESHOLD / 255.0f;
-    state->gamepad.left_trigger.threshold = trigger_threshold;
-    state->gamepad.right_trigger.threshold = trigger_threshold;
-    state->gamepad.left_thumb_stick.threshold = XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE / 32767.0f;;
-    state->gamepad.right_thumb_stick.threshold = XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE / 32767.0f;
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        state->gamepads[index].left_trigger.threshold = trigger_threshold;
+        state->gamepads[index].right_trigger.threshold = trigger_threshold;
+        state->gamepads[index].left_thumb_stick.threshold = XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE / 32767.0f;
+        state->gamepads[index].right_thumb_stick.threshold = XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE / 32767.0f;
+    }
+    return EX_TRUE;
+}
+
+void *
+EXMU_opengl_proc(const char *name) {
+    void *proc = (void *)wglGetProcAddress(name);
+    if (proc == (void *)1 || proc == (void *)2 || proc == (void *)3 || proc == (void *)-1) return 0;
+    return proc;
+}
+
+GLuint
+EXMU_opengl_shader(GLenum type, const char *source) {
+    GLuint shader = ex_glCreateShader(type);
+    ex_glShaderSource(shader, 1, &source, 0);
+    ex_glCompileShader(shader);
+    GLint compiled = 0;
+    ex_glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        ex_glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+EXBOOL
+EXMU_opengl_modern_initialize(EXMU *state) {
+#define EX_GL_LOAD(type, name, args) \
+    ex_##name = (EX_##name##_PROC *)EXMU_opengl_proc(#name); \
+    if (!ex_##name) return EX_FALSE;
+    EX_GL_PROCS(EX_GL_LOAD)
+#undef EX_GL_LOAD
+
+    GLuint vertex_shader = EXMU_opengl_shader(GL_VERTEX_SHADER, ex_gl_vertex_shader);
+    GLuint fragment_shader = EXMU_opengl_shader(GL_FRAGMENT_SHADER, ex_gl_fragment_shader);
+    if (!vertex_shader || !fragment_shader) return EX_FALSE;
+    GLuint program = ex_glCreateProgram();
+    ex_glAttachShader(program, vertex_shader);
+    ex_glAttachShader(program, fragment_shader);
+    ex_glLinkProgram(program);
+    ex_glDeleteShader(vertex_shader);
+    ex_glDeleteShader(fragment_shader);
+    GLint linked = 0;
+    ex_glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) return EX_FALSE;
+
+    state->win32.program = program;
+    ex_glGenVertexArrays(1, &state->win32.vertex_array);
     return EX_TRUE;
 }
 
@@ -416,16 +1010,17 @@ EXMU_opengl_initialize(EXMU *state) {
         return EX_FALSE;
     }
     wglMakeCurrent(state->win32.device_context, state->win32.wgl_context);
+    state->win32.modern_opengl = EXMU_opengl_modern_initialize(state);
     return EX_TRUE;
 }
 
 EXBOOL
 EXMU_initialize(EXMU *state) {
-    if (!EXMU_window_initialize(state)) return EX_FALSE;
+    if (!state->headless && !EXMU_window_initialize(state)) return EX_FALSE;
     if (!EXMU_time_initialize(state)) return EX_FALSE;
-    if (!EXMU_mouse_initialize(state)) return EX_FALSE;
+    if (!state->headless && !EXMU_mouse_initialize(state)) return EX_FALSE;
     if (!EXMU_gamepad_initialize(state)) return EX_FALSE;
-    if (!EXMU_opengl_initialize(state)) return EX_FALSE;
+    if (!state->headless && !EXMU_opengl_initialize(state)) return EX_FALSE;
     
     state->initialized = EX_TRUE;
     EXMU_pull(state);
@@ -0,0 +1,327 @@
+#include "flow.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const EXINT2 flow_steps[8] = {
+    {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1},
+};
+
+static const EXFLOAT2 flow_vectors[FLOW_NONE + 1] = {
+    {1.0f, 0.0f}, {0.70710678f, 0.70710678f}, {0.0f, 1.0f}, {-0.70710678f, 0.70710678f},
+    {-1.0f, 0.0f}, {-0.70710678f, -0.70710678f}, {0.0f, -1.0f}, {0.70710678f, -0.70710678f},
+    {0.0f, 0.0f},
+};
+
+// same movement rule as the pathfinder, diagonals never cut a solid corner
+static EXBOOL flow_passable(WORLD *world, int x, int y, EXINT2 step) {
+    if (world_solid(world, x + step.x, y + step.y)) return EX_FALSE;
+    if (step.x && step.y && (world_solid(world, x + step.x, y) || world_solid(world, x, y + step.y))) return EX_FALSE;
+    return EX_TRUE;
+}
+
+static void flow_heap_move(FLOWFIELD *field, int index, int cell) {
+    field->heap[index] = cell;
+    field->heap_positions[cell] = index;
+}
+
+static void flow_heap_push(FLOWFIELD *field, int cell) {
+    int index = field->heap_positions[cell];
+    if (index < 0) index = field->heap_count++;
+    int cost = field->costs[cell];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (field->costs[field->heap[parent]] <= cost) break;
+        flow_heap_move(field, index, field->heap[parent]);
+        index = parent;
+    }
+    flow_heap_move(field, index, cell);
+}
+
+static int flow_heap_pop(FLOWFIELD *field) {
+    int top = field->heap[0];
+    int last = field->heap[--field->heap_count];
+    field->heap_positions[top] = -1;
+    if (!field->heap_count) return top;
+    int cost = field->costs[last];
+    int index = 0;
+    for (;;) {
+        int child = index * 2 + 1;
+        if (child >= field->heap_count) break;
+        if (child + 1 < field->heap_count && field->costs[field->heap[child + 1]] < field->costs[field->heap[child]]) child += 1;
+        if (cost <= field->costs[field->heap[child]]) break;
+        flow_heap_move(field, index, field->heap[child]);
+        index = child;
+    }
+    flow_heap_move(field, index, last);
+    return top;
+}
+
+// Dijkstra from whatever is queued, every cell only ever gets cheaper
+static void flow_propagate(FLOWFIELD *field) {
+    WORLD *world = field->world;
+    int dimension = field->dimension;
+    while (field->heap_count) {
+        int cell = flow_heap_pop(field);
+        field->visited[field->visited_count++] = cell;
+        int x = cell % dimension;
+        int y = cell / dimension;
+        for (int direction = 0; direction < 8; direction++) {
+            EXINT2 step = flow_steps[direction];
+            if (!flow_passable(world, x, y, step)) continue;
+            int neighbor = cell + step.x + step.y * dimension;
+            int cost = field->costs[cell] + ((direction & 1) ? FLOW_COST_DIAGONAL : FLOW_COST_STRAIGHT);
+            if (cost >= field->costs[neighbor]) continue;
+            field->costs[neighbor] = cost;
+            flow_heap_push(field, neighbor);
+        }
+    }
+}
+
+static void flow_direct(FLOWFIELD *field, int cell) {
+    if (field->stamps[cell] == field->stamp) return;
+    field->stamps[cell] = field->stamp;
+    WORLD *world = field->world;
+    int dimension = field->dimension;
+    int x = cell % dimension;
+    int y = cell / dimension;
+    int best = FLOW_NONE;
+    int best_cost = field->costs[cell];
+    if (best_cost == FLOW_UNREACHED) {
+        field->directions[cell] = FLOW_NONE;
+        return;
+    }
+    for (int direction = 0; direction < 8; direction++) {
+        EXINT2 step = flow_steps[direction];
+        if (!flow_passable(world, x, y, step)) continue;
+        int cost = field->costs[cell + step.x + step.y * dimension];
+        if (cost == FLOW_UNREACHED) continue;
+        cost += (direction & 1) ? FLOW_COST_DIAGONAL : FLOW_COST_STRAIGHT;
+        if (cost <= best_cost) {
+            best = direction;
+            best_cost = cost;
+        }
+    }
+    field->directions[cell] = (uint8_t)best;
+}
+
+// a cell's direction depends on its neighbors' costs, so they are redone with it
+static void flow_direct_around(FLOWFIELD *field, int cell) {
+    WORLD *world = field->world;
+    int dimension = field->dimension;
+    int x = cell % dimension;
+    int y = cell / dimension;
+    flow_direct(field, cell);
+    for (int direction = 0; direction < 8; direction++) {
+        EXINT2 step = flow_steps[direction];
+        if (world_solid(world, x + step.x, y + step.y)) continue;
+        flow_direct(field, cell + step.x + step.y * dimension);
+    }
+}
+
+static void flow_next_stamp(FLOWFIELD *field) {
+    field->stamp += 1;
+    if (field->stamp == 0) {
+        memset(field->stamps, 0, field->dimension * field->dimension * sizeof(uint32_t));
+        field->stamp = 1;
+    }
+}
+
+static void flow_rebuild(FLOWFIELD *field, int goal) {
+    int count = field->dimension * field->dimension;
+    for (int cell = 0; cell < count; cell++) field->costs[cell] = FLOW_UNREACHED;
+    field->offset = 0;
+    field->visited_count = 0;
+    field->costs[goal] = 0;
+    flow_heap_push(field, goal);
+    flow_propagate(field);
+    flow_next_stamp(field);
+    for (int cell = 0; cell < count; cell++) flow_direct(field, cell);
+    field->rebuilds += 1;
+    field->propagated += field->visited_count;
+}
+
+EXBOOL flow_initialize(FLOWFIELD *field, WORLD *world, EXARENA *arena) {
+    int count = world->dimension * world->dimension;
+    field->world = world;
+    field->dimension = world->dimension;
+    field->valid = EX_FALSE;
+    field->heap_count = 0;
+    field->costs = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    field->directions = (uint8_t *)EXMU_arena_push(arena, count, 64);
+    field->heap = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    field->heap_positions = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    field->visited = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    field->raised = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    field->stamps = (uint32_t *)EXMU_arena_push(arena, count * sizeof(uint32_t), 64);
+    field->stamp = 0;
+    if (!field->costs || !field->directions || !field->heap || !field->heap_positions || !field->visited || !field->raised || !field->stamps) {
+        field->costs = 0;
+        return EX_FALSE;
+    }
+    memset(field->stamps, 0, count * sizeof(uint32_t));
+    for (int cell = 0; cell < count; cell++) field->heap_positions[cell] = -1;
+    return EX_TRUE;
+}
+
+// the buffers go with the arena they came from
+void flow_destroy(FLOWFIELD *field) {
+    field->valid = EX_FALSE;
+    field->costs = 0;
+    field->directions = 0;
+    field->heap = 0;
+    field->heap_positions = 0;
+    field->visited = 0;
+    field->raised = 0;
+    field->stamps = 0;
+}
+
+static EXBOOL flow_supported(FLOWFIELD *field, int cell) {
+    WORLD *world = field->world;
+    int dimension = field->dimension;
+    int x = cell % dimension;
+    int y = cell / dimension;
+    for (int direction = 0; direction < 8; direction++) {
+        EXINT2 step = flow_steps[direction];
+        if (!flow_passable(world, x, y, step)) continue;
+        int cost = field->costs[cell + step.x + step.y * dimension];
+        if (cost == FLOW_UNREACHED) continue;
+        if (cost + ((direction & 1) ? FLOW_COST_DIAGONAL : FLOW_COST_STRAIGHT) == field->costs[cell]) return EX_TRUE;
+    }
+    return EX_FALSE;
+}
+
+static void flow_queue(FLOWFIELD *field, int *count, int cell) {
+    if (field->stamps[cell] == field->stamp) return;
+    field->stamps[cell] = field->stamp;
+    field->heap[(*count)++] = cell;
+}
+
+// takes the cheapest cost through a passable neighbor and queues the cell to relax its own neighbors
+static void flow_relax(FLOWFIELD *field, int cell) {
+    WORLD *world = field->world;
+    int dimension = field->dimension;
+    int x = cell % dimension;
+    int y = cell / dimension;
+    if (world_solid(world, x, y)) return;
+    for (int direction = 0; direction < 8; direction++) {
+        EXINT2 step = flow_steps[direction];
+        if (!flow_passable(world, x, y, step)) continue;
+        int cost = field->costs[cell + step.x + step.y * dimension];
+        if (cost == FLOW_UNREACHED) continue;
+        cost += (direction & 1) ? FLOW_COST_DIAGONAL : FLOW_COST_STRAIGHT;
+        if (cost < field->costs[cell]) field->costs[cell] = cost;
+    }
+    if (field->costs[cell] != FLOW_UNREACHED) flow_heap_push(field, cell);
+}
+
+// edits only move costs near the dirty rectangle and downstream of it: a cell that lost every
+// neighbor its cost came through is raised to unreached along with the cells that came through it,
+// then those and the cells around the edit are relaxed and the wavefront carries on from them;
+// the rectangle is grown by one because a cell also opens or blocks the diagonals around it
+void flow_world_changed(void *data, WORLD *world, int x, int y, int width, int height, int changes) {
+    FLOWFIELD *field = (FLOWFIELD *)data;
+    if (!(changes & WORLD_CHANGED_SOLID) || !field->valid) return;
+    // an edit that was missed leaves the revisions apart and flow_update rebuilds
+    if (field->revision + 1 != world->solid_revision) return;
+    field->revision = world->solid_revision;
+    if (world_solid(world, field->goal.x, field->goal.y)) {
+        field->valid = EX_FALSE;
+        return;
+    }
+    int dimension = field->dimension;
+    int goal_cell = field->goal.x + field->goal.y * dimension;
+    int x0 = x > 0 ? x - 1 : 0;
+    int y0 = y > 0 ? y - 1 : 0;
+    int x1 = x + width < dimension ? x + width : dimension - 1;
+    int y1 = y + height < dimension ? y + height : dimension - 1;
+
+    // RAISE, the idle heap array doubles as the work stack and stamps mark queued cells
+    int pending = 0;
+    field->raised_count = 0;
+    flow_next_stamp(field);
+    for (int cell_y = y0; cell_y <= y1; cell_y++) {
+        for (int cell_x = x0; cell_x <= x1; cell_x++) flow_queue(field, &pending, cell_x + cell_y * dimension);
+    }
+    while (pending) {
+        int cell = field->heap[--pending];
+        field->stamps[cell] = 0;
+        int cost = field->costs[cell];
+        if (cost == FLOW_UNREACHED || cell == goal_cell) continue;
+        int cell_x = cell % dimension;
+        int cell_y = cell / dimension;
+        if (!world_solid(world, cell_x, cell_y) && flow_supported(field, cell)) continue;
+        field->costs[cell] = FLOW_UNREACHED;
+        field->raised[field->raised_count++] = cell;
+        for (int direction = 0; direction < 8; direction++) {
+            EXINT2 step = flow_steps[direction];
+            int neighbor_x = cell_x + step.x;
+            int neighbor_y = cell_y + step.y;
+            if (neighbor_x < 0 || neighbor_y < 0 || neighbor_x >= dimension || neighbor_y >= dimension) continue;
+            int neighbor = neighbor_x + neighbor_y * dimension;
+            if (field->costs[neighbor] == cost + ((direction & 1) ? FLOW_COST_DIAGONAL : FLOW_COST_STRAIGHT)) flow_queue(field, &pending, neighbor);
+        }
+    }
+
+    // LOWER
+    field->visited_count = 0;
+    for (int cell_y = y0; cell_y <= y1; cell_y++) {
+        for (int cell_x = x0; cell_x <= x1; cell_x++) flow_relax(field, cell_x + cell_y * dimension);
+    }
+    for (int index = 0; index < field->raised_count; index++) flow_relax(field, field->raised[index]);
+    flow_propagate(field);
+
+    // DIRECT
+    flow_next_stamp(field);
+    for (int cell_y = y0; cell_y <= y1; cell_y++) {
+        for (int cell_x = x0; cell_x <= x1; cell_x++) flow_direct(field, cell_x + cell_y * dimension);
+    }
+    for (int index = 0; index < field->raised_count; index++) flow_direct_around(field, field->raised[index]);
+    for (int index = 0; index < field->visited_count; index++) flow_direct_around(field, field->visited[index]);
+    field->repairs += 1;
+    field->propagated += field->visited_count;
+}
+
+// every old cost plus the old distance between the two goals is a real path to the new goal, so
+// those stay as upper bounds and the wavefront from the new goal only visits cells that got closer
+void flow_update(FLOWFIELD *field, EXINT2 goal) {
+    WORLD *world = field->world;
+    int dimension = field->dimension;
+    if (!field->costs || world_solid(world, goal.x, goal.y)) return;
+    int goal_cell = goal.x + goal.y * dimension;
+
+    if (field->valid && field->revision == world->solid_revision) {
+        if (goal.x == field->goal.x && goal.y == field->goal.y) return;
+        int moved = abs(goal.x - field->goal.x) > abs(goal.y - field->goal.y) ? abs(goal.x - field->goal.x) : abs(goal.y - field->goal.y);
+        int stored = field->costs[goal_cell];
+        if (moved <= FLOW_MAX_GOAL_STEP && stored != FLOW_UNREACHED && stored + field->offset < FLOW_MAX_OFFSET - field->offset) {
+            field->offset += stored + field->offset;
+            field->goal = goal;
+            field->visited_count = 0;
+            field->costs[goal_cell] = -field->offset;
+            flow_heap_push(field, goal_cell);
+            flow_propagate(field);
+            flow_next_stamp(field);
+            for (int index = 0; index < field->visited_count; index++) flow_direct_around(field, field->visited[index]);
+            field->propagated += field->visited_count;
+            return;
+        }
+    }
+
+    field->goal = goal;
+    field->valid = EX_TRUE;
+    field->revision = world->solid_revision;
+    flow_rebuild(field, goal_cell);
+}
+
+int flow_distance(FLOWFIELD *field, int x, int y) {
+    if (!field->valid || x < 0 || y < 0 || x >= field->dimension || y >= field->dimension) return FLOW_UNREACHED;
+    int cost = field->costs[x + y * field->dimension];
+    return cost == FLOW_UNREACHED ? FLOW_UNREACHED : cost + field->offset;
+}
+
+EXFLOAT2 flow_sample(FLOWFIELD *field, EXFLOAT2 position) {
+    int x = (int)(position.x / field->world->tile_size);
+    int y = (int)(position.y / field->world->tile_size);
+    if (!field->valid || x < 0 || y < 0 || x >= field->dimension || y >= field->dimension) return flow_vectors[FLOW_NONE];
+    return flow_vectors[field->directions[x + y * field->dimension]];
+}
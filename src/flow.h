@@ -0,0 +1,45 @@
+#pragma once
+
+#include "exmu.h"
+#include "world.h"
+
+#define FLOW_COST_STRAIGHT 100
+#define FLOW_COST_DIAGONAL 141
+#define FLOW_UNREACHED 0x7FFFFFFF
+#define FLOW_NONE 8
+#define FLOW_MAX_GOAL_STEP 8
+#define FLOW_MAX_OFFSET (1 << 28)
+
+// costs are stored relative to offset so moving the goal can raise every cell at once, a cell's
+// integrated distance to the goal is costs[cell] + offset
+struct FLOWFIELD {
+    WORLD *world;
+    int dimension;
+    EXINT2 goal;
+    EXBOOL valid;
+    uint32_t revision;
+    int offset;
+
+    int *costs;
+    uint8_t *directions;
+    int *heap;
+    int *heap_positions;
+    int heap_count;
+    int *visited;
+    int visited_count;
+    int *raised;
+    int raised_count;
+    uint32_t *stamps;
+    uint32_t stamp;
+
+    uint64_t rebuilds;
+    uint64_t repairs;
+    uint64_t propagated;
+};
+
+EXBOOL flow_initialize(FLOWFIELD *field, WORLD *world, EXARENA *arena);
+void flow_destroy(FLOWFIELD *field);
+void flow_world_changed(void *data, WORLD *world, int x, int y, int width, int height, int changes);
+void flow_update(FLOWFIELD *field, EXINT2 goal);
+int flow_distance(FLOWFIELD *field, int x, int y);
+EXFLOAT2 flow_sample(FLOWFIELD *field, EXFLOAT2 position);
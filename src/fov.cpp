@@ -0,0 +1,164 @@
+#include "fov.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const int fov_octants[4][8] = {
+    {1, 0, 0, -1, -1, 0, 0, 1},
+    {0, 1, -1, 0, 0, -1, 1, 0},
+    {0, 1, 1, 0, 0, -1, -1, 0},
+    {1, 0, 0, 1, -1, 0, 0, -1},
+};
+
+static void fov_set(FOV *fov, int x, int y) {
+    if (x < 0 || y < 0 || x >= fov->dimension || y >= fov->dimension) return;
+    fov->bits[y * fov->stride + x / 64] |= (uint64_t)1 << (x % 64);
+}
+
+// recursive shadowcasting, scans rows of one octant outward and recurses under every run of
+// blockers with the narrowed slope range
+static void fov_cast(FOV *fov, WORLD *world, EXINT2 origin, int row, float start, float end, int radius,
+                     int xx, int xy, int yx, int yy) {
+    if (start < end) return;
+    int radius_squared = radius * radius;
+    float next_start = start;
+    for (int distance = row; distance <= radius; distance++) {
+        EXBOOL blocked = EX_FALSE;
+        int dy = -distance;
+        for (int dx = -distance; dx <= 0; dx++) {
+            float left_slope = (dx - 0.5f) / (dy + 0.5f);
+            float right_slope = (dx + 0.5f) / (dy - 0.5f);
+            if (start < right_slope) continue;
+            if (end > left_slope) break;
+
+            int x = origin.x + dx * xx + dy * xy;
+            int y = origin.y + dx * yx + dy * yy;
+            if (dx * dx + dy * dy <= radius_squared) fov_set(fov, x, y);
+            EXBOOL solid = world_solid(world, x, y);
+            if (blocked) {
+                if (solid) {
+                    next_start = right_slope;
+                } else {
+                    blocked = EX_FALSE;
+                    start = next_start;
+                }
+            } else if (solid && distance < radius) {
+                blocked = EX_TRUE;
+                fov_cast(fov, world, origin, distance + 1, start, left_slope, radius, xx, xy, yx, yy);
+                next_start = right_slope;
+            }
+        }
+        if (blocked) break;
+    }
+}
+
+EXBOOL fov_initialize(FOV *fov, int dimension, EXARENA *arena) {
+    fov->dimension = dimension;
+    fov->stride = (dimension + 63) / 64;
+    fov->bits = (uint64_t *)EXMU_arena_push(arena, fov->stride * dimension * sizeof(uint64_t), 64);
+    fov_clear(fov);
+    return fov->bits != 0;
+}
+
+// the bits go with the arena they came from
+void fov_destroy(FOV *fov) {
+    fov->bits = 0;
+}
+
+void fov_clear(FOV *fov) {
+    if (fov->bits) memset(fov->bits, 0, fov->stride * fov->dimension * sizeof(uint64_t));
+}
+
+// a radius of zero or less is only limited by the map
+void fov_compute(FOV *fov, WORLD *world, EXINT2 origin, int radius) {
+    if (!fov->bits) return;
+    fov_clear(fov);
+    if (radius <= 0) radius = 2 * fov->dimension;
+    fov_set(fov, origin.x, origin.y);
+    for (int octant = 0; octant < 8; octant++) {
+        fov_cast(fov, world, origin, 1, 1.0f, 0.0f, radius,
+                 fov_octants[0][octant], fov_octants[1][octant], fov_octants[2][octant], fov_octants[3][octant]);
+    }
+}
+
+EXBOOL fov_visible(FOV *fov, int x, int y) {
+    if (x < 0 || y < 0 || x >= fov->dimension || y >= fov->dimension) return EX_FALSE;
+    return (fov->bits[y * fov->stride + x / 64] >> (x % 64)) & 1;
+}
+
+int fov_count(FOV *fov) {
+    int count = 0;
+    for (int word = 0; word < fov->stride * fov->dimension; word++) count += __builtin_popcountll(fov->bits[word]);
+    return count;
+}
+
+void fov_union(FOV *result, FOV *fov) {
+    for (int word = 0; word < result->stride * result->dimension; word++) result->bits[word] |= fov->bits[word];
+}
+
+void fov_intersect(FOV *result, FOV *fov) {
+    for (int word = 0; word < result->stride * result->dimension; word++) result->bits[word] &= fov->bits[word];
+}
+
+static void fov_batch_work(FOVBATCH *batch) {
+    for (;;) {
+        int index = batch->next.fetch_add(1);
+        if (index >= batch->viewer_count) break;
+        FOVVIEWER *viewer = batch->viewers + index;
+        fov_compute(viewer->fov, batch->world, viewer->origin, viewer->radius);
+    }
+}
+
+static void fov_batch_worker(void *data) {
+    FOVBATCH *batch = (FOVBATCH *)data;
+    for (;;) {
+        EXMU_semaphore_wait(batch->start_semaphore, EX_TRUE);
+        if (batch->quit) break;
+        {
+            EX_PROFILE_SCOPE("fov worker");
+            fov_batch_work(batch);
+        }
+        EXMU_semaphore_signal(batch->done_semaphore);
+    }
+}
+
+EXBOOL fov_batch_start(FOVBATCH *batch, int thread_count) {
+    if (thread_count > FOV_MAX_THREADS) thread_count = FOV_MAX_THREADS;
+    batch->quit = EX_FALSE;
+    batch->thread_count = 0;
+    batch->start_semaphore = EXMU_semaphore_create(0, FOV_MAX_THREADS);
+    batch->done_semaphore = EXMU_semaphore_create(0, FOV_MAX_THREADS);
+    if (!batch->start_semaphore || !batch->done_semaphore) {
+        fov_batch_stop(batch);
+        return EX_FALSE;
+    }
+    for (int index = 0; index < thread_count; index++) {
+        batch->threads[index] = EXMU_thread_create(fov_batch_worker, batch);
+        if (!batch->threads[index]) break;
+        batch->thread_count += 1;
+    }
+    return EX_TRUE;
+}
+
+// the calling thread takes viewers too, so a batch without workers runs serially
+void fov_batch_run(FOVBATCH *batch, WORLD *world, FOVVIEWER *viewers, int viewer_count) {
+    EX_PROFILE_SCOPE("fov");
+    batch->world = world;
+    batch->viewers = viewers;
+    batch->viewer_count = viewer_count;
+    batch->next.store(0);
+    int waking = batch->thread_count < viewer_count - 1 ? batch->thread_count : viewer_count - 1;
+    for (int index = 0; index < waking; index++) EXMU_semaphore_signal(batch->start_semaphore);
+    fov_batch_work(batch);
+    for (int index = 0; index < waking; index++) EXMU_semaphore_wait(batch->done_semaphore, EX_TRUE);
+}
+
+void fov_batch_stop(FOVBATCH *batch) {
+    batch->quit = EX_TRUE;
+    for (int index = 0; index < batch->thread_count; index++) EXMU_semaphore_signal(batch->start_semaphore);
+    for (int index = 0; index < batch->thread_count; index++) EXMU_thread_join(batch->threads[index]);
+    batch->thread_count = 0;
+    EXMU_semaphore_destroy(batch->start_semaphore);
+    EXMU_semaphore_destroy(batch->done_semaphore);
+    batch->start_semaphore = 0;
+    batch->done_semaphore = 0;
+}
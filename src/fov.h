@@ -0,0 +1,45 @@
+#pragma once
+
+#include "exmu.h"
+#include "world.h"
+#include <atomic>
+
+#define FOV_MAX_THREADS 16
+
+// visible cells packed like WORLD::solid, one row of stride words per cell row
+struct FOV {
+    int dimension;
+    int stride;
+    uint64_t *bits;
+};
+
+struct FOVVIEWER {
+    EXINT2 origin;
+    int radius;
+    FOV *fov;
+};
+
+struct FOVBATCH {
+    WORLD *world;
+    FOVVIEWER *viewers;
+    int viewer_count;
+    std::atomic<int> next;
+
+    int thread_count;
+    void *threads[FOV_MAX_THREADS];
+    void *start_semaphore;
+    void *done_semaphore;
+    EXBOOL quit;
+};
+
+EXBOOL fov_initialize(FOV *fov, int dimension, EXARENA *arena);
+void fov_destroy(FOV *fov);
+void fov_clear(FOV *fov);
+void fov_compute(FOV *fov, WORLD *world, EXINT2 origin, int radius);
+EXBOOL fov_visible(FOV *fov, int x, int y);
+int fov_count(FOV *fov);
+void fov_union(FOV *result, FOV *fov);
+void fov_intersect(FOV *result, FOV *fov);
+EXBOOL fov_batch_start(FOVBATCH *batch, int thread_count);
+void fov_batch_run(FOVBATCH *batch, WORLD *world, FOVVIEWER *viewers, int viewer_count);
+void fov_batch_stop(FOVBATCH *batch);
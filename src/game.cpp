@@ -0,0 +1,366 @@
+#include "exmu.h"
+#include "game.h"
+#include "check.h"
+#include "golden.h"
+#include "host.h"
+#include "instance.h"
+#include "overlay.h"
+#include "raycast.h"
+#include "render.h"
+#include "resolution.h"
+#include "terrain.h"
+#include "world.h"
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#define ORIGINAL_TILE_SIZE 16
+#define SCREEN_ROWS 15
+#define SCREEN_COLUMNS 20
+
+#define SCALE 3
+#define TILE_SIZE (ORIGINAL_TILE_SIZE * SCALE)
+#if 1
+#define WINDOW_WIDTH (TILE_SIZE * SCREEN_COLUMNS)
+#define WINDOW_HEIGHT (TILE_SIZE * SCREEN_ROWS)
+#endif
+
+#define VISIBILITY_THREADS 2
+
+#define RENDER_MODE_TILES 0
+#define RENDER_MODE_TERRAIN 1
+
+#define STREAM_SLOTS 8
+#define STREAM_SLOT_SIZE (64 << 10)
+#define STREAM_THREADS 1
+
+#define MAP_DIMENSION 8
+
+// the pack holds PACK_LAYOUTS layouts of one byte per cell, the first matches map and F7 streams in
+// the next, doors stay where map puts them
+#define PACK_PATH "data/world.pak"
+#define PACK_LAYOUTS 2
+
+static const int map[MAP_DIMENSION * MAP_DIMENSION] = {
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 0, 0, 0, 1,
+    1, 0, 2, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+struct GAME {
+    OVERLAY overlay;
+    RESOLUTION resolution;
+    RENDERER renderer;
+    TERRAIN terrain;
+    int render_mode;
+    uint16_t serve_port;
+    INSTANCE *instance;
+    int layout;
+    EXBOOL layout_pending;
+    uint64_t stream_failed;
+};
+
+static double to_radians(double degrees) {
+    return degrees * (M_PI / 180.0);
+}
+
+// headless server mode, prints each instance's step rate and cost once a second
+static int run_host(GAMEMEMORY *memory, int instance_count, int seconds) {
+    void *host_memory = EXMU_arena_push(&memory->arena, sizeof(HOST), 64);
+    if (!host_memory) {
+        fprintf(stderr, "Failed to allocate host.\n");
+        return 1;
+    }
+    HOST *host = new (host_memory) HOST();
+    host->crowd = EX_TRUE;
+    if (!host_start(host, instance_count, map, MAP_DIMENSION, TILE_SIZE)) {
+        fprintf(stderr, "Failed to start %d instances.\n", instance_count);
+        return 1;
+    }
+    uint64_t previous_steps[HOST_MAX_INSTANCES] = {};
+    uint64_t previous_work[HOST_MAX_INSTANCES] = {};
+    for (int second = 0; !seconds || second < seconds; second++) {
+        EXMU_sleep(1000);
+        for (int index = 0; index < host->instance_count; index++) {
+            HOSTSLOT *slot = host->slots + index;
+            uint64_t steps = slot->steps.load();
+            uint64_t work = slot->work_nanoseconds.load();
+            uint64_t delta_steps = steps - previous_steps[index];
+            printf("instance %d cpu %d%s: %llu steps %.1f us/step\n", index, slot->cpu, slot->failed.load() ? " failed" : "",
+                   (unsigned long long)delta_steps, delta_steps ? (work - previous_work[index]) / 1000.0 / delta_steps : 0.0);
+            previous_steps[index] = steps;
+            previous_work[index] = work;
+        }
+    }
+    host_stop(host);
+    return 0;
+}
+
+static void game_request_layout(EXMU *exmu, GAME *game, int layout) {
+    WORLD *world = &game->instance->world;
+    int count = world->dimension * world->dimension;
+    EXFLOAT2 centre = {world->dimension * world->tile_size / 2.0f, world->dimension * world->tile_size / 2.0f};
+    if (!EXMU_stream_request(exmu, layout, PACK_PATH, (uint64_t)layout * count, count, centre)) {
+        fprintf(stderr, "%s\n", exmu->error);
+        return;
+    }
+    game->layout = layout;
+    game->layout_pending = EX_TRUE;
+    game->stream_failed = exmu->stream.failed;
+}
+
+// cells under a player are left alone so nobody ends up inside a wall
+static void game_apply_layout(EXMU *exmu, GAME *game) {
+    INSTANCE *instance = game->instance;
+    WORLD *world = &instance->world;
+    int count = world->dimension * world->dimension;
+    uint32_t size = 0;
+    const uint8_t *cells = (const uint8_t *)EXMU_stream_find(exmu, game->layout, &size);
+    if (!cells) {
+        if (exmu->stream.failed != game->stream_failed) {
+            fprintf(stderr, "Failed to stream layout %d from %s.\n", game->layout, PACK_PATH);
+            game->layout_pending = EX_FALSE;
+        }
+        return;
+    }
+    if (size == (uint32_t)count) {
+        for (int index = 0; index < count; index++) {
+            int x = index % world->dimension;
+            int y = index / world->dimension;
+            if (cells[index] > WORLD_WALL || world->map[index] == WORLD_DOOR || world->map[index] == cells[index]) continue;
+            EXBOOL occupied = EX_FALSE;
+            for (int player = 0; player < EX_MAX_GAMEPADS; player++) {
+                EXFLOAT2 position = instance->players[player].position;
+                occupied |= instance->active_players[player] && (int)(position.x / world->tile_size) == x &&
+                            (int)(position.y / world->tile_size) == y;
+            }
+            if (!occupied) world_set_cell(world, x, y, cells[index]);
+        }
+    } else {
+        fprintf(stderr, "Layout %d in %s is %u bytes, expected %d.\n", game->layout, PACK_PATH, size, count);
+    }
+    EXMU_stream_release(exmu, game->layout);
+    game->layout_pending = EX_FALSE;
+}
+
+static GAME *game_create(EXMU *exmu, GAMEMEMORY *memory) {
+    void *game_memory = EXMU_arena_push(&memory->arena, sizeof(GAME), 64);
+    if (!game_memory) return 0;
+    GAME *game = new (game_memory) GAME();
+    game->render_mode = RENDER_MODE_TILES;
+    for (int arg = 1; arg < memory->argc; arg++) {
+        if (strcmp(memory->argv[arg], "--serve") == 0 && arg + 1 < memory->argc) game->serve_port = (uint16_t)atoi(memory->argv[++arg]);
+    }
+
+    INSTANCE *instance = instance_create(&memory->arena, map, MAP_DIMENSION, TILE_SIZE, VISIBILITY_THREADS, game->serve_port);
+    if (!instance) return 0;
+    game->instance = instance;
+    WORLD *world = &instance->world;
+    WORLDCELL *cells = world->cells;
+    cells[2 + 2 * world->dimension].floor = world->tile_size / 3;
+    cells[2 + 3 * world->dimension].floor = world->tile_size / 3;
+    cells[4 + 1 * world->dimension].floor = world->tile_size / 6;
+    cells[5 + 5 * world->dimension].floor = world->tile_size / 4;
+    cells[5 + 5 * world->dimension].ceiling = world->tile_size * 3 / 4;
+    render_initialize(&game->renderer, &exmu->framebuffer, world->tile_size);
+    game_request_layout(exmu, game, 0);
+    
+#ifdef _DEBUG
+    game->overlay.visible = EX_TRUE;
+#endif
+    game->overlay.budget_milliseconds = 1000.0f / 60.0f;
+    game->resolution.budget_milliseconds = 1000.0f / 60.0f;
+
+    memory->state = game;
+    memory->state_size = sizeof(GAME);
+    return game;
+}
+
+GAME_EXPORT GAME_START(game_start) {
+    const char *golden_path = 0;
+    EXBOOL golden_update = EX_FALSE;
+    EXBOOL check = EX_FALSE;
+    int instance_count = 0;
+    int seconds = 0;
+    for (int arg = 1; arg < memory->argc; arg++) {
+        char **argv = memory->argv;
+        if (strcmp(argv[arg], "--golden") == 0 && arg + 1 < memory->argc) golden_path = argv[++arg];
+        else if (strcmp(argv[arg], "--golden-update") == 0) golden_update = EX_TRUE;
+        else if (strcmp(argv[arg], "--check") == 0) check = EX_TRUE;
+        else if (strcmp(argv[arg], "--instances") == 0 && arg + 1 < memory->argc) instance_count = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--seconds") == 0 && arg + 1 < memory->argc) seconds = atoi(argv[++arg]);
+    }
+    if (golden_path) return golden_run(exmu, golden_path, golden_update) ? 1 : 0;
+    if (check) return check_run(exmu) ? 1 : 0;
+    if (instance_count) return run_host(memory, instance_count, seconds);
+
+    exmu->window.size.x = WINDOW_WIDTH;
+    exmu->window.size.y = WINDOW_HEIGHT;
+    exmu->window.centered = EX_TRUE;
+    if (!EXMU_stream_start(exmu, STREAM_SLOTS, STREAM_SLOT_SIZE, STREAM_THREADS)) fprintf(stderr, "%s\n", exmu->error);
+    return -1;
+}
+
+GAME_EXPORT GAME_UPDATE(game_update) {
+    GAME *game = (GAME *)memory->state;
+    if (!game) {
+        game = game_create(exmu, memory);
+        if (!game) {
+            fprintf(stderr, "Failed to create game.\n");
+            exmu->quit = EX_TRUE;
+            return;
+        }
+    } else if (memory->reloaded) {
+        memory->reloaded = EX_FALSE;
+        if (memory->state_size != sizeof(GAME)) {
+            fprintf(stderr, "Game state layout changed, restart to apply.\n");
+            exmu->quit = EX_TRUE;
+            return;
+        }
+        if (!instance_attach(game->instance)) fprintf(stderr, "Failed to start visibility threads.\n");
+    }
+    INSTANCE *instance = game->instance;
+    WORLD *world = &instance->world;
+
+    if (exmu->keyboard.keys[EX_KEY_ESCAPE].pressed) exmu->quit = EX_TRUE;
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        if (exmu->gamepads[index].start_button.pressed) exmu->quit = EX_TRUE;
+    }
+    if (exmu->keyboard.keys[EX_KEY_F1].pressed) game->overlay.visible = !game->overlay.visible;
+    if (exmu->keyboard.keys[EX_KEY_F4].pressed) {
+        for (int door = 0; door < world->door_count; door++) {
+            int cell = world->doors[door].cell;
+            world_door(world, cell % world->dimension, cell / world->dimension, world->doors[door].target == 0.0f);
+        }
+    }
+    if (exmu->keyboard.keys[EX_KEY_F5].pressed) {
+        world_set_cell(world, 5, 5, world->map[5 + 5 * world->dimension] == WORLD_EMPTY ? WORLD_WALL : WORLD_EMPTY);
+    }
+    if (exmu->keyboard.keys[EX_KEY_F7].pressed && !game->layout_pending) {
+        game_request_layout(exmu, game, (game->layout + 1) % PACK_LAYOUTS);
+    }
+    if (game->layout_pending) game_apply_layout(exmu, game);
+    if (exmu->keyboard.keys[EX_KEY_F6].pressed) {
+        if (instance->crowd.count) instance->crowd.count = 0;
+        else instance_spawn_crowd(instance);
+    }
+    if (exmu->keyboard.keys[EX_KEY_F3].pressed) {
+        world->heights = !world->heights;
+        world->revision += 1;
+    }
+    if (exmu->keyboard.keys[EX_KEY_F2].pressed) {
+        if (game->render_mode == RENDER_MODE_TILES && (game->terrain.heights || terrain_generate(&game->terrain, TERRAIN_SIZE, 1))) {
+            game->render_mode = RENDER_MODE_TERRAIN;
+        } else {
+            game->render_mode = RENDER_MODE_TILES;
+        }
+    }
+    if (exmu->keyboard.keys[EX_KEY_F10].pressed) {
+        if (!EXMU_capture_sequence(exmu, exmu->capture.sequence ? 0 : "capture", EX_CAPTURE_QOI)) fprintf(stderr, "%s\n", exmu->error);
+    }
+    if (exmu->keyboard.keys[EX_KEY_F11].pressed) EXMU_profile_export(exmu, "profile.json", 120);
+    if (exmu->keyboard.keys[EX_KEY_F12].pressed) {
+        if (!EXMU_capture_screenshot(exmu, EX_CAPTURE_QOI)) fprintf(stderr, "%s\n", exmu->error);
+    }
+    
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        instance->active_players[index] = index == 0 || exmu->gamepads[index].connected;
+    }
+    exmu->stream.camera = instance->players[0].position;
+    {
+        EX_PROFILE_SCOPE("simulate");
+        instance_simulate(instance, exmu->gamepads, exmu->time.delta_seconds);
+        instance_visibility(instance);
+    }
+
+    // SNAPSHOT
+    {
+        SNAPSHOTSERVER *snapshot_server = &instance->snapshot_server;
+        uint64_t encoded_bytes = snapshot_server->encoded_bytes;
+        uint64_t encode_ticks = snapshot_server->encode_ticks;
+        instance_snapshot(instance);
+        game->overlay.snapshot_bytes = snapshot_server->encoded_bytes - encoded_bytes;
+        game->overlay.snapshot_microseconds = exmu->profile.ticks_per_second > 0.0
+            ? (float)((snapshot_server->encode_ticks - encode_ticks) * 1000000.0 / exmu->profile.ticks_per_second) : 0.0f;
+    }
+    
+    resolution_update(&game->resolution, exmu->time.work_nanoseconds / 1000000.0f, exmu->window.size);
+    EXMU_framebuffer_resize(exmu, game->resolution.columns, game->resolution.rows);
+    
+    // SPLIT SCREEN
+    int view_players[EX_MAX_GAMEPADS];
+    int view_count = 0;
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        if (instance->active_players[index]) view_players[view_count++] = index;
+    }
+    int ray_count = exmu->framebuffer.width / view_count;
+    double fov = 80.0;
+    RAYHIT hits[view_count * ray_count];
+    RAYVIEW views[EX_MAX_GAMEPADS];
+    for (int view = 0; view < view_count; view++) {
+        int index = view_players[view];
+        PLAYER interpolated = instance_interpolate_player(instance, index);
+        views[view].position = interpolated.position;
+        views[view].angle = interpolated.angle;
+        views[view].hits = hits + view * ray_count;
+    }
+    {
+        EX_COUNTER_SCOPE("cast");
+        raycaster_configure(&instance->raycaster, ray_count, (float)to_radians(fov));
+        if (game->render_mode == RENDER_MODE_TILES && !world->heights) raycaster_cast_views(&instance->raycaster, world, views, view_count);
+        game->overlay.rays = instance->raycaster.rays;
+        game->overlay.cells = instance->raycaster.cells;
+        game->overlay.cached = instance->raycaster.cached;
+    }
+
+    {
+        EX_COUNTER_SCOPE("draw");
+        if (game->render_mode == RENDER_MODE_TERRAIN) {
+            game->terrain.samples = 0;
+            for (int view = 0; view < view_count; view++) {
+                float camera_height = terrain_height(&game->terrain, views[view].position) + TERRAIN_EYE_HEIGHT;
+                terrain_render(&game->terrain, &instance->raycaster, &game->renderer, &exmu->framebuffer,
+                               views[view].position, views[view].angle, camera_height, view * ray_count);
+            }
+            game->overlay.rays = view_count * ray_count;
+            game->overlay.cells = game->terrain.samples;
+            game->overlay.cached = 0;
+        } else if (world->heights) {
+            instance->raycaster.rays = 0;
+            instance->raycaster.cells = 0;
+            for (int view = 0; view < view_count; view++) {
+                render_cells(&game->renderer, &exmu->framebuffer, &instance->raycaster, world,
+                             views[view].position, views[view].angle, view * ray_count);
+            }
+            game->overlay.rays = instance->raycaster.rays;
+            game->overlay.cells = instance->raycaster.cells;
+            game->overlay.cached = 0;
+        } else {
+            EXMU_framebuffer_clear(&exmu->framebuffer, RENDER_CLEAR_COLOR);
+            for (int view = 0; view < view_count; view++) {
+                render_walls(&game->renderer, &exmu->framebuffer, views[view].hits, view * ray_count, ray_count, world->tile_size);
+            }
+        }
+        overlay_draw(&game->overlay, &exmu->frame_stats, &exmu->framebuffer, 4, 4);
+    }
+}
+
+GAME_EXPORT GAME_UNLOAD(game_unload) {
+    GAME *game = (GAME *)memory->state;
+    if (game) instance_detach(game->instance);
+}
+
+GAME_EXPORT GAME_STOP(game_stop) {
+    GAME *game = (GAME *)memory->state;
+    if (game) {
+        instance_destroy(game->instance);
+        terrain_destroy(&game->terrain);
+    }
+    memory->state = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "exmu.h"
+
+#ifdef _WIN32
+#define GAME_MODULE_NAME "game.dll"
+#define GAME_EXPORT extern "C" __declspec(dllexport)
+#else
+#define GAME_MODULE_NAME "game.so"
+#define GAME_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+#define GAME_MEMORY_SIZE (32 << 20)
+
+// owned by the platform and kept across module reloads, the game keeps all of its state in the arena
+struct GAMEMEMORY {
+    EXARENA arena;
+    void *state;
+    size_t state_size;
+    EXBOOL reloaded;
+    int argc;
+    char **argv;
+};
+
+// start runs before EXMU_initialize and returns an exit code for headless commands or -1 to open the window
+#define GAME_START(name) int name(EXMU *exmu, GAMEMEMORY *memory)
+#define GAME_UPDATE(name) void name(EXMU *exmu, GAMEMEMORY *memory)
+#define GAME_UNLOAD(name) void name(EXMU *exmu, GAMEMEMORY *memory)
+#define GAME_STOP(name) void name(EXMU *exmu, GAMEMEMORY *memory)
+
+typedef GAME_START(GAMESTART);
+typedef GAME_UPDATE(GAMEUPDATE);
+typedef GAME_UNLOAD(GAMEUNLOAD);
+typedef GAME_STOP(GAMESTOP);
+
+struct GAMECODE {
+    EXMODULE module;
+    GAMESTART *start;
+    GAMEUPDATE *update;
+    GAMEUNLOAD *unload;
+    GAMESTOP *stop;
+};
@@ -0,0 +1,276 @@
+#include "golden.h"
+#include "raycast.h"
+#include "render.h"
+#include "terrain.h"
+#include <stdlib.h>
+
+#define GOLDEN_TILE_SIZE 48
+#define GOLDEN_MAX_VIEWS 4
+#define P2 (float)(M_PI / 2)
+#define P3 (float)(3 * M_PI / 2)
+
+enum {
+    GOLDEN_WALLS,
+    GOLDEN_VIEWS,
+    GOLDEN_CELLS,
+    GOLDEN_TERRAIN,
+};
+
+// a views case splits the screen between views in pairs that share a position, the second pair
+// a tile further along x, every view turned a little more than the one before
+struct GOLDENCASE {
+    int scene;
+    int map;
+    EXFLOAT2 position;
+    float angle;
+    int view_count;
+};
+
+static int golden_room[8 * 8] = {
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+static int golden_pillars[16 * 16] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 1,
+    1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1,
+    1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+// doors are opened to a quarter, half and fully in golden_run
+static int golden_doors[8 * 8] = {
+    1, 1, 1, 1, 1, 1, 1, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 2, 1, 0, 0, 1, 2, 1,
+    1, 0, 1, 0, 0, 1, 0, 1,
+    1, 0, 1, 2, 1, 1, 0, 1,
+    1, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+static WORLDCELL golden_cells[8 * 8];
+static WORLD golden_worlds[3];
+
+// axis-aligned angles, angles next to the wraparound and positions on tile edges
+static const GOLDENCASE golden_cases[] = {
+    {GOLDEN_WALLS, 0, {192.0f, 192.0f}, 0.0f, 1},
+    {GOLDEN_WALLS, 0, {192.0f, 192.0f}, P2, 1},
+    {GOLDEN_WALLS, 0, {192.0f, 192.0f}, (float)M_PI, 1},
+    {GOLDEN_WALLS, 0, {192.0f, 192.0f}, P3, 1},
+    {GOLDEN_WALLS, 0, {192.0f, 192.0f}, 0.001f, 1},
+    {GOLDEN_WALLS, 0, {192.0f, 192.0f}, (float)(2 * M_PI) - 0.001f, 1},
+    {GOLDEN_WALLS, 0, {72.0f, 72.0f}, (float)(M_PI / 4), 1},
+    {GOLDEN_WALLS, 0, {144.0f, 192.0f}, 2.5f, 1},
+    {GOLDEN_WALLS, 0, {100.5f, 300.25f}, 5.2f, 1},
+    {GOLDEN_WALLS, 0, {312.0f, 312.0f}, (float)(5 * M_PI / 4), 1},
+    {GOLDEN_WALLS, 1, {384.0f, 384.0f}, 0.0f, 1},
+    {GOLDEN_WALLS, 1, {384.0f, 384.0f}, 1.0f, 1},
+    {GOLDEN_WALLS, 1, {72.0f, 700.0f}, (float)(7 * M_PI / 4), 1},
+    {GOLDEN_WALLS, 1, {240.0f, 144.0f}, P2, 1},
+    {GOLDEN_WALLS, 1, {600.5f, 96.0f}, 3.3f, 1},
+    {GOLDEN_WALLS, 1, {705.0f, 705.0f}, (float)(5 * M_PI / 4), 1},
+    {GOLDEN_VIEWS, 1, {384.0f, 384.0f}, 0.0f, 2},
+    {GOLDEN_VIEWS, 1, {240.0f, 144.0f}, 1.0f, 4},
+    {GOLDEN_WALLS, 2, {72.0f, 264.0f}, P3, 1},
+    {GOLDEN_WALLS, 2, {312.0f, 264.0f}, P3, 1},
+    {GOLDEN_WALLS, 2, {168.0f, 312.0f}, P3, 1},
+    {GOLDEN_WALLS, 2, {168.0f, 300.0f}, 4.0f, 1},
+    {GOLDEN_CELLS, 0, {72.0f, 72.0f}, (float)(M_PI / 4), 1},
+    {GOLDEN_CELLS, 0, {300.0f, 120.0f}, 2.6f, 1},
+    {GOLDEN_TERRAIN, 0, {2048.0f, 2048.0f}, 0.0f, 1},
+    {GOLDEN_TERRAIN, 0, {1000.0f, 3000.0f}, 4.0f, 1},
+};
+
+static EXBOOL golden_read(const char *path, uint32_t *pixels, int width, int height) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return EX_FALSE;
+    int file_width = 0;
+    int file_height = 0;
+    int maximum = 0;
+    EXBOOL valid = fscanf(file, "P6 %d %d %d", &file_width, &file_height, &maximum) == 3 &&
+                   file_width == width && file_height == height && maximum == 255 && fgetc(file) != EOF;
+    for (int index = 0; valid && index < width * height; index++) {
+        uint8_t rgb[3];
+        if (fread(rgb, 1, 3, file) != 3) valid = EX_FALSE;
+        pixels[index] = 0xFF000000 | (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+    }
+    fclose(file);
+    return valid;
+}
+
+static EXBOOL golden_write(const char *path, uint32_t *pixels, int width, int height) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return EX_FALSE;
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int index = 0; index < width * height; index++) {
+        uint8_t rgb[3] = {(uint8_t)(pixels[index] >> 16), (uint8_t)(pixels[index] >> 8), (uint8_t)pixels[index]};
+        fwrite(rgb, 1, 3, file);
+    }
+    return fclose(file) == 0;
+}
+
+static EXBOOL golden_match(uint32_t a, uint32_t b) {
+    for (int shift = 0; shift < 24; shift += 8) {
+        int delta = (int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF);
+        if (delta > GOLDEN_CHANNEL_TOLERANCE || delta < -GOLDEN_CHANNEL_TOLERANCE) return EX_FALSE;
+    }
+    return EX_TRUE;
+}
+
+static void golden_render(const GOLDENCASE *golden_case, RAYCASTER *raycaster, RENDERER *renderer, TERRAIN *terrain,
+                          EXFRAMEBUFFER *framebuffer, RAYHIT *hits) {
+    WORLD *world = golden_worlds + golden_case->map;
+    float fov = (float)(GOLDEN_FOV * M_PI / 180.0);
+    EXMU_framebuffer_clear(framebuffer, RENDER_CLEAR_COLOR);
+    if (golden_case->scene == GOLDEN_VIEWS) {
+        int columns = GOLDEN_WIDTH / golden_case->view_count;
+        RAYVIEW views[GOLDEN_MAX_VIEWS];
+        for (int view = 0; view < golden_case->view_count; view++) {
+            views[view].position.x = golden_case->position.x + (view / 2) * GOLDEN_TILE_SIZE;
+            views[view].position.y = golden_case->position.y;
+            views[view].angle = golden_case->angle + view * 0.9f;
+            views[view].hits = hits + view * columns;
+        }
+        raycaster_configure(raycaster, columns, fov);
+        raycaster_invalidate(raycaster);
+        raycaster_cast_views(raycaster, world, views, golden_case->view_count);
+        for (int view = 0; view < golden_case->view_count; view++) {
+            render_walls(renderer, framebuffer, views[view].hits, view * columns, columns, GOLDEN_TILE_SIZE);
+        }
+        return;
+    }
+
+    raycaster_configure(raycaster, GOLDEN_WIDTH, fov);
+    if (golden_case->scene == GOLDEN_CELLS) {
+        world->heights = EX_TRUE;
+        render_cells(renderer, framebuffer, raycaster, world, golden_case->position, golden_case->angle, 0);
+        world->heights = EX_FALSE;
+    } else if (golden_case->scene == GOLDEN_TERRAIN) {
+        float camera_height = terrain_height(terrain, golden_case->position) + TERRAIN_EYE_HEIGHT;
+        terrain_render(terrain, raycaster, renderer, framebuffer, golden_case->position, golden_case->angle, camera_height, 0);
+    } else {
+        raycaster_invalidate(raycaster);
+        raycaster_cast(raycaster, world, golden_case->position, golden_case->angle, hits);
+        render_walls(renderer, framebuffer, hits, 0, GOLDEN_WIDTH, GOLDEN_TILE_SIZE);
+    }
+}
+
+int golden_run(EXMU *state, const char *directory, EXBOOL update) {
+    static RENDERER renderer;
+    RAYCASTER raycaster = {};
+    TERRAIN terrain = {};
+    EXARENA arena = {};
+    EXFRAMEBUFFER *framebuffer = &state->framebuffer;
+    if (!EXMU_framebuffer_resize(state, GOLDEN_WIDTH, GOLDEN_HEIGHT) ||
+        !raycaster_configure(&raycaster, GOLDEN_WIDTH, (float)(GOLDEN_FOV * M_PI / 180.0))) {
+        fprintf(stderr, "Failed to allocate golden framebuffer.\n");
+        return 1;
+    }
+    render_initialize(&renderer, framebuffer, GOLDEN_TILE_SIZE);
+    golden_worlds[0].dimension = 8;
+    golden_worlds[0].tile_size = GOLDEN_TILE_SIZE;
+    golden_worlds[0].map = golden_room;
+    golden_worlds[1].dimension = 16;
+    golden_worlds[1].tile_size = GOLDEN_TILE_SIZE;
+    golden_worlds[1].map = golden_pillars;
+    golden_worlds[2].dimension = 8;
+    golden_worlds[2].tile_size = GOLDEN_TILE_SIZE;
+    golden_worlds[2].map = golden_doors;
+
+    // the room doubles as the cells world, with a platform, a step and a block hanging over a gap
+    for (int index = 0; index < 8 * 8; index++) {
+        golden_cells[index].floor = golden_room[index] ? GOLDEN_TILE_SIZE : 0;
+        golden_cells[index].ceiling = GOLDEN_TILE_SIZE;
+    }
+    golden_cells[3 + 1 * 8].floor = GOLDEN_TILE_SIZE / 3;
+    golden_cells[4 + 1 * 8].floor = GOLDEN_TILE_SIZE / 6;
+    golden_cells[2 + 3 * 8].floor = GOLDEN_TILE_SIZE / 4;
+    golden_cells[2 + 3 * 8].ceiling = GOLDEN_TILE_SIZE * 3 / 4;
+    golden_worlds[0].cells = golden_cells;
+
+    int count = GOLDEN_WIDTH * GOLDEN_HEIGHT;
+    int max_mismatches = (int)(count * GOLDEN_MISMATCH_RATIO);
+    uint32_t *expected = (uint32_t *)malloc(count * sizeof(uint32_t));
+    RAYHIT *hits = (RAYHIT *)malloc(GOLDEN_WIDTH * sizeof(RAYHIT));
+    int failures = 0;
+    if (!expected || !hits || !EXMU_arena_create(&arena, GOLDEN_ARENA_SIZE) || !world_initialize(&golden_worlds[2], &arena) ||
+        !terrain_generate(&terrain, TERRAIN_SIZE, 1)) {
+        fprintf(stderr, "Failed to allocate golden scenes.\n");
+        failures = 1;
+    } else {
+        float openings[] = {0.25f, 0.5f, 1.0f};
+        for (int door = 0; door < golden_worlds[2].door_count; door++) {
+            golden_worlds[2].openings[golden_worlds[2].doors[door].cell] = openings[door % 3];
+        }
+    }
+    int case_count = failures ? 0 : sizeof(golden_cases) / sizeof(golden_cases[0]);
+    for (int index = 0; index < case_count; index++) {
+        const GOLDENCASE *golden_case = golden_cases + index;
+        golden_render(golden_case, &raycaster, &renderer, &terrain, framebuffer, hits);
+        EXMU_framebuffer_expand(framebuffer, framebuffer->pixels);
+
+        char path[EX_MAX_CAPTURE_PATH];
+        snprintf(path, sizeof(path), "%s/golden_%02d.ppm", directory, index);
+        if (update) {
+            if (!golden_write(path, framebuffer->pixels, GOLDEN_WIDTH, GOLDEN_HEIGHT)) {
+                fprintf(stderr, "golden %02d: failed to write %s\n", index, path);
+                failures += 1;
+            }
+            continue;
+        }
+        if (!golden_read(path, expected, GOLDEN_WIDTH, GOLDEN_HEIGHT)) {
+            fprintf(stderr, "golden %02d: missing or invalid %s\n", index, path);
+            failures += 1;
+            continue;
+        }
+
+        // DIFF
+        int mismatches = 0;
+        for (int pixel = 0; pixel < count; pixel++) {
+            uint32_t actual = framebuffer->pixels[pixel];
+            if (golden_match(actual, expected[pixel])) {
+                expected[pixel] = 0xFF000000 | ((actual >> 2) & 0x3F3F3F);
+            } else {
+                expected[pixel] = GOLDEN_DIFF_COLOR;
+                mismatches += 1;
+            }
+        }
+        if (mismatches > max_mismatches) {
+            snprintf(path, sizeof(path), "%s/golden_%02d.diff.ppm", directory, index);
+            golden_write(path, expected, GOLDEN_WIDTH, GOLDEN_HEIGHT);
+            fprintf(stderr, "golden %02d: FAILED, %d pixels differ, diff written to %s\n", index, mismatches, path);
+            failures += 1;
+        } else {
+            printf("golden %02d: ok (%d pixels differ)\n", index, mismatches);
+        }
+    }
+    printf("golden: %d of %d cases %s\n", case_count - failures, case_count, update ? "updated" : "passed");
+
+    free(expected);
+    free(hits);
+    raycaster_destroy(&raycaster);
+    world_destroy(&golden_worlds[2]);
+    terrain_destroy(&terrain);
+    EXMU_arena_destroy(&arena);
+    return failures;
+}
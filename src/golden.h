@@ -0,0 +1,14 @@
+#pragma once
+
+#include "exmu.h"
+
+#define GOLDEN_WIDTH 320
+#define GOLDEN_HEIGHT 200
+#define GOLDEN_FOV 80.0f
+#define GOLDEN_CHANNEL_TOLERANCE 8
+#define GOLDEN_MISMATCH_RATIO 0.001f
+#define GOLDEN_DIFF_COLOR 0xFFFF0000
+#define GOLDEN_ARENA_SIZE (64 << 10)
+
+// the reference images live in data/golden, run with --golden data/golden and add --golden-update to rewrite them
+int golden_run(EXMU *state, const char *directory, EXBOOL update);
@@ -0,0 +1,83 @@
+#include "host.h"
+
+static void host_instance_thread(void *data) {
+    HOSTSLOT *slot = (HOSTSLOT *)data;
+    HOST *host = slot->host;
+    EXMU_thread_pin(slot->cpu);
+
+    // allocated after pinning so the pages are first touched on this core's node
+    if (!EXMU_arena_create(&slot->arena, HOST_ARENA_SIZE)) {
+        slot->failed.store(EX_TRUE);
+        return;
+    }
+    INSTANCE *instance = instance_create(&slot->arena, host->map, host->dimension, host->tile_size, 0, 0);
+    if (!instance) {
+        slot->failed.store(EX_TRUE);
+        EXMU_arena_destroy(&slot->arena);
+        return;
+    }
+    slot->instance = instance;
+    if (host->crowd) instance_spawn_crowd(instance);
+
+    uint64_t step_nanoseconds = 1000000000ull / INSTANCE_SIMULATION_HZ;
+    uint64_t next = EXMU_nanoseconds();
+    while (!host->quit.load(std::memory_order_relaxed)) {
+        uint64_t begin = EXMU_nanoseconds();
+        {
+            EX_COUNTER_SCOPE("instance");
+            instance_simulate(instance, 0, 1.0f / INSTANCE_SIMULATION_HZ);
+            instance_visibility(instance);
+            instance_snapshot(instance);
+        }
+        uint64_t end = EXMU_nanoseconds();
+        slot->steps.fetch_add(1, std::memory_order_relaxed);
+        slot->work_nanoseconds.fetch_add(end - begin, std::memory_order_relaxed);
+
+        // an instance that fell behind drops the missed steps instead of bursting through them
+        next += step_nanoseconds;
+        if (end > next + step_nanoseconds) next = end;
+        for (uint64_t now = end; now < next; now = EXMU_nanoseconds()) {
+            EXMU_sleep((uint32_t)((next - now) / 1000000));
+        }
+    }
+
+    instance_destroy(instance);
+    slot->instance = 0;
+    EXMU_arena_destroy(&slot->arena);
+    EXMU_counters_close();
+}
+
+// instances are spread round robin over the cores
+EXBOOL host_start(HOST *host, int instance_count, const int *map, int dimension, int tile_size) {
+    if (instance_count > HOST_MAX_INSTANCES) instance_count = HOST_MAX_INSTANCES;
+    int cpu_count = EXMU_cpu_count();
+    if (cpu_count < 1) cpu_count = 1;
+    host->map = map;
+    host->dimension = dimension;
+    host->tile_size = tile_size;
+    host->quit.store(EX_FALSE);
+    host->instance_count = 0;
+    for (int index = 0; index < instance_count; index++) {
+        HOSTSLOT *slot = host->slots + index;
+        slot->host = host;
+        slot->index = index;
+        slot->cpu = index % cpu_count;
+        slot->instance = 0;
+        slot->steps.store(0);
+        slot->work_nanoseconds.store(0);
+        slot->failed.store(EX_FALSE);
+        slot->thread = EXMU_thread_create(host_instance_thread, slot);
+        if (!slot->thread) {
+            host_stop(host);
+            return EX_FALSE;
+        }
+        host->instance_count += 1;
+    }
+    return EX_TRUE;
+}
+
+void host_stop(HOST *host) {
+    host->quit.store(EX_TRUE);
+    for (int index = 0; index < host->instance_count; index++) EXMU_thread_join(host->slots[index].thread);
+    host->instance_count = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "exmu.h"
+#include "instance.h"
+#include <atomic>
+
+#define HOST_MAX_INSTANCES 64
+#define HOST_ARENA_SIZE (8 << 20)
+
+struct HOST;
+
+struct HOSTSLOT {
+    HOST *host;
+    int index;
+    int cpu;
+    void *thread;
+    EXARENA arena;
+    INSTANCE *instance;
+
+    std::atomic<uint64_t> steps;
+    std::atomic<uint64_t> work_nanoseconds;
+    std::atomic<EXBOOL> failed;
+};
+
+// each instance is created, simulated and destroyed by its own pinned thread
+struct HOST {
+    const int *map;
+    int dimension;
+    int tile_size;
+    EXBOOL crowd;
+    std::atomic<EXBOOL> quit;
+    int instance_count;
+    HOSTSLOT slots[HOST_MAX_INSTANCES];
+};
+
+EXBOOL host_start(HOST *host, int instance_count, const int *map, int dimension, int tile_size);
+void host_stop(HOST *host);
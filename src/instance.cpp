@@ -0,0 +1,238 @@
+#include "instance.h"
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+static float instance_wrap_angle(float angle) {
+    if (angle < 0.0f) angle += 2 * M_PI;
+    if (angle > 2 * M_PI) angle -= 2 * M_PI;
+    return angle;
+}
+
+static void instance_simulate_player(PLAYER *player, EXGAMEPAD *gamepad, float delta_seconds) {
+    if (gamepad->right_thumb_stick.x < 0) {
+        player->angle = instance_wrap_angle(player->angle - player->rotation_speed * delta_seconds);
+    }
+    if (gamepad->right_thumb_stick.x > 0) {
+        player->angle = instance_wrap_angle(player->angle + player->rotation_speed * delta_seconds);
+    }
+    player->delta_position.x = cos(player->angle) * player->move_speed * delta_seconds;
+    player->delta_position.y = sin(player->angle) * player->move_speed * delta_seconds;
+    if (gamepad->left_thumb_stick.y > 0) {
+        player->position.x += player->delta_position.x;
+        player->position.y += player->delta_position.y;
+    }
+    if (gamepad->left_thumb_stick.y < 0) {
+        player->position.x -= player->delta_position.x;
+        player->position.y -= player->delta_position.y;
+    }
+}
+
+static void instance_crowd_push(void *data, int a, int b) {
+    CROWD *crowd = (CROWD *)data;
+    float dx = crowd->positions[b].x - crowd->positions[a].x;
+    float dy = crowd->positions[b].y - crowd->positions[a].y;
+    float distance = sqrtf(dx * dx + dy * dy);
+    if (distance < 0.001f) {
+        dx = 1.0f;
+        distance = 1.0f;
+    }
+    float strength = (INSTANCE_CROWD_RADIUS - distance) / (INSTANCE_CROWD_RADIUS * distance);
+    crowd->pushes[a].x -= dx * strength;
+    crowd->pushes[a].y -= dy * strength;
+    crowd->pushes[b].x += dx * strength;
+    crowd->pushes[b].y += dy * strength;
+}
+
+static void instance_simulate_crowd(INSTANCE *instance, float delta_seconds) {
+    CROWD *crowd = &instance->crowd;
+    WORLD *world = &instance->world;
+    spatial_rebuild(&instance->spatial, crowd->positions, crowd->count);
+    memset(crowd->pushes, 0, crowd->count * sizeof(EXFLOAT2));
+    spatial_pairs(&instance->spatial, INSTANCE_CROWD_RADIUS, instance_crowd_push, crowd);
+    for (int index = 0; index < crowd->count; index++) {
+        EXFLOAT2 *position = crowd->positions + index;
+        EXFLOAT2 direction = flow_sample(&instance->flow, *position);
+        float x = position->x + (direction.x + crowd->pushes[index].x) * INSTANCE_CROWD_SPEED * delta_seconds;
+        float y = position->y + (direction.y + crowd->pushes[index].y) * INSTANCE_CROWD_SPEED * delta_seconds;
+        if (!world_solid(world, (int)(x / world->tile_size), (int)(position->y / world->tile_size))) position->x = x;
+        if (!world_solid(world, (int)(position->x / world->tile_size), (int)(y / world->tile_size))) position->y = y;
+    }
+}
+
+static EXBOOL instance_initialize(INSTANCE *instance, EXARENA *arena, const int *map, int dimension, int tile_size, int visibility_threads, uint16_t serve_port) {
+    int count = dimension * dimension;
+    int *instance_map = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    WORLDCELL *cells = (WORLDCELL *)EXMU_arena_push(arena, count * sizeof(WORLDCELL), 64);
+    if (!instance_map || !cells) return EX_FALSE;
+    memcpy(instance_map, map, count * sizeof(int));
+    instance->arena = arena;
+    for (int index = 0; index < count; index++) {
+        cells[index].floor = map[index] ? tile_size : 0;
+        cells[index].ceiling = tile_size;
+    }
+
+    WORLD *world = &instance->world;
+    world->dimension = dimension;
+    world->tile_size = tile_size;
+    world->map = instance_map;
+    world->cells = cells;
+    if (!world_initialize(world, arena)) return EX_FALSE;
+    if (!pathfinder_initialize(&instance->pathfinder, world, arena)) return EX_FALSE;
+    if (!flow_initialize(&instance->flow, world, arena)) return EX_FALSE;
+    if (!spatial_initialize(&instance->spatial, tile_size, dimension, INSTANCE_MAX_ACTORS, arena)) return EX_FALSE;
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        if (!fov_initialize(&instance->visibility[index], dimension, arena)) return EX_FALSE;
+    }
+    if (!fov_initialize(&instance->team_visibility, dimension, arena)) return EX_FALSE;
+    instance->visibility_threads = visibility_threads;
+    if (!instance_attach(instance)) return EX_FALSE;
+
+    if (serve_port) {
+        if (!EXMU_transport_udp(&instance->server_transport, serve_port)) return EX_FALSE;
+    } else {
+        if (!EXMU_transport_loopback(&instance->server_transport, &instance->client_transport)) return EX_FALSE;
+        snapshot_receiver_initialize(&instance->snapshot_receiver, &instance->client_transport,
+                                     instance->server_transport.address, world, INSTANCE_ENTITIES);
+    }
+    if (!snapshot_server_initialize(&instance->snapshot_server, &instance->server_transport, world, INSTANCE_ENTITIES)) return EX_FALSE;
+
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        PLAYER *player = instance->players + index;
+        player->position.x = tile_size * (dimension / 2);
+        player->position.y = tile_size * (dimension / 2);
+        player->angle = index * (float)(M_PI / 2);
+        player->move_speed = 120.0f;
+        player->rotation_speed = 3.0f;
+        instance->previous_players[index] = *player;
+    }
+    instance->active_players[0] = EX_TRUE;
+    return EX_TRUE;
+}
+
+// a serve_port of zero serves a local receiver over loopback instead of UDP
+INSTANCE *instance_create(EXARENA *arena, const int *map, int dimension, int tile_size, int visibility_threads, uint16_t serve_port) {
+    void *memory = EXMU_arena_push(arena, sizeof(INSTANCE), 64);
+    if (!memory) return 0;
+    INSTANCE *instance = new (memory) INSTANCE();
+    if (!instance_initialize(instance, arena, map, dimension, tile_size, visibility_threads, serve_port)) {
+        instance_destroy(instance);
+        return 0;
+    }
+    return instance;
+}
+
+// world listeners and visibility workers point into the code that created them, so a reloaded
+// module detaches them before it is unloaded and attaches its own afterwards
+EXBOOL instance_attach(INSTANCE *instance) {
+    WORLD *world = &instance->world;
+    world->listener_count = 0;
+    world_listen(world, raycaster_world_changed, &instance->raycaster);
+    world_listen(world, pathfinder_world_changed, &instance->pathfinder);
+    world_listen(world, flow_world_changed, &instance->flow);
+    return fov_batch_start(&instance->visibility_batch, instance->visibility_threads);
+}
+
+void instance_detach(INSTANCE *instance) {
+    fov_batch_stop(&instance->visibility_batch);
+    instance->world.listener_count = 0;
+}
+
+// module buffers and the instance memory go with the arena, what remains are the threads, sockets and
+// the raycaster's resizable buffers; a failed instance_create leaves the rest zero and it is skipped
+void instance_destroy(INSTANCE *instance) {
+    fov_batch_stop(&instance->visibility_batch);
+    EXMU_transport_close(&instance->server_transport);
+    EXMU_transport_close(&instance->client_transport);
+    raycaster_destroy(&instance->raycaster);
+    pathfinder_destroy(&instance->pathfinder);
+    flow_destroy(&instance->flow);
+    spatial_destroy(&instance->spatial);
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) fov_destroy(&instance->visibility[index]);
+    fov_destroy(&instance->team_visibility);
+    world_destroy(&instance->world);
+}
+
+void instance_spawn_crowd(INSTANCE *instance) {
+    CROWD *crowd = &instance->crowd;
+    WORLD *world = &instance->world;
+    crowd->count = 0;
+    int cell_count = world->dimension * world->dimension;
+    for (int index = 0; index < INSTANCE_MAX_ACTORS && cell_count; index++) {
+        int cell = (index * 7) % cell_count;
+        int x = cell % world->dimension;
+        int y = cell / world->dimension;
+        if (world_solid(world, x, y)) continue;
+        float jitter = (float)(index % 5) - 2.0f;
+        crowd->positions[crowd->count].x = (x + 0.5f) * world->tile_size + jitter * 4.0f;
+        crowd->positions[crowd->count].y = (y + 0.5f) * world->tile_size - jitter * 4.0f;
+        crowd->count += 1;
+    }
+}
+
+// gamepads may be null for instances without local input
+void instance_simulate(INSTANCE *instance, EXGAMEPAD *gamepads, float delta_seconds) {
+    static EXGAMEPAD idle;
+    WORLD *world = &instance->world;
+    float simulation_step = 1.0f / INSTANCE_SIMULATION_HZ;
+    instance->simulation_accumulator += delta_seconds;
+    if (instance->simulation_accumulator > INSTANCE_MAX_STEPS * simulation_step) {
+        instance->simulation_accumulator = INSTANCE_MAX_STEPS * simulation_step;
+    }
+    while (instance->simulation_accumulator >= simulation_step) {
+        for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+            instance->previous_players[index] = instance->players[index];
+            instance_simulate_player(&instance->players[index], gamepads ? &gamepads[index] : &idle, simulation_step);
+        }
+        world_update(world, simulation_step);
+        EXINT2 goal = {(int)(instance->players[0].position.x / world->tile_size), (int)(instance->players[0].position.y / world->tile_size)};
+        flow_update(&instance->flow, goal);
+        instance_simulate_crowd(instance, simulation_step);
+        instance->simulation_accumulator -= simulation_step;
+        instance->steps += 1;
+    }
+}
+
+void instance_visibility(INSTANCE *instance) {
+    FOVVIEWER viewers[EX_MAX_GAMEPADS];
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        viewers[index].origin.x = (int)(instance->players[index].position.x / instance->world.tile_size);
+        viewers[index].origin.y = (int)(instance->players[index].position.y / instance->world.tile_size);
+        viewers[index].radius = INSTANCE_VISIBILITY_RADIUS;
+        viewers[index].fov = &instance->visibility[index];
+    }
+    fov_batch_run(&instance->visibility_batch, &instance->world, viewers, EX_MAX_GAMEPADS);
+    fov_clear(&instance->team_visibility);
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        if (instance->active_players[index]) fov_union(&instance->team_visibility, &instance->visibility[index]);
+    }
+}
+
+void instance_snapshot(INSTANCE *instance) {
+    SNAPSHOTSERVER *server = &instance->snapshot_server;
+    for (int index = 0; index < EX_MAX_GAMEPADS; index++) {
+        snapshot_server_entity(server, index, instance->active_players[index], instance->players[index].position, instance->players[index].angle);
+    }
+    for (int index = 0; index < INSTANCE_MAX_ACTORS; index++) {
+        snapshot_server_entity(server, EX_MAX_GAMEPADS + index, index < instance->crowd.count, instance->crowd.positions[index], 0.0f);
+    }
+    snapshot_server_receive(server);
+    if (instance->client_transport.type && server->client_count) server->clients[0].visibility = &instance->team_visibility;
+    snapshot_server_send(server);
+    if (instance->client_transport.type) snapshot_receiver_update(&instance->snapshot_receiver);
+}
+
+PLAYER instance_interpolate_player(INSTANCE *instance, int index) {
+    PLAYER *a = &instance->previous_players[index];
+    PLAYER *b = &instance->players[index];
+    float alpha = instance->simulation_accumulator * INSTANCE_SIMULATION_HZ;
+    PLAYER result = *b;
+    result.position.x = a->position.x + (b->position.x - a->position.x) * alpha;
+    result.position.y = a->position.y + (b->position.y - a->position.y) * alpha;
+    float delta_angle = b->angle - a->angle;
+    if (delta_angle > M_PI) delta_angle -= 2 * M_PI;
+    if (delta_angle < -M_PI) delta_angle += 2 * M_PI;
+    result.angle = instance_wrap_angle(a->angle + delta_angle * alpha);
+    return result;
+}
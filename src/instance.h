@@ -0,0 +1,70 @@
+#pragma once
+
+#include "exmu.h"
+#include "flow.h"
+#include "fov.h"
+#include "path.h"
+#include "raycast.h"
+#include "snapshot.h"
+#include "spatial.h"
+#include "world.h"
+
+#define INSTANCE_SIMULATION_HZ 60
+#define INSTANCE_MAX_STEPS 8
+#define INSTANCE_MAX_ACTORS 256
+#define INSTANCE_ENTITIES (EX_MAX_GAMEPADS + INSTANCE_MAX_ACTORS)
+#define INSTANCE_CROWD_SPEED 60.0f
+#define INSTANCE_CROWD_RADIUS 12.0f
+#define INSTANCE_VISIBILITY_RADIUS 16
+
+struct PLAYER {
+    EXFLOAT2 position;
+    EXFLOAT2 delta_position;
+    float angle;
+    float move_speed;
+    float rotation_speed;
+};
+
+struct CROWD {
+    int count;
+    EXFLOAT2 positions[INSTANCE_MAX_ACTORS];
+    EXFLOAT2 pushes[INSTANCE_MAX_ACTORS];
+};
+
+// everything one match simulates and casts, the instance itself and its map live in the arena it
+// was created from so nothing is shared between instances
+struct INSTANCE {
+    EXARENA *arena;
+    WORLD world;
+
+    PLAYER players[EX_MAX_GAMEPADS];
+    PLAYER previous_players[EX_MAX_GAMEPADS];
+    EXBOOL active_players[EX_MAX_GAMEPADS];
+    CROWD crowd;
+    float simulation_accumulator;
+    uint64_t steps;
+
+    RAYCASTER raycaster;
+    PATHFINDER pathfinder;
+    FLOWFIELD flow;
+    SPATIALHASH spatial;
+    FOV visibility[EX_MAX_GAMEPADS];
+    FOV team_visibility;
+    FOVBATCH visibility_batch;
+    int visibility_threads;
+
+    EXTRANSPORT server_transport;
+    EXTRANSPORT client_transport;
+    SNAPSHOTSERVER snapshot_server;
+    SNAPSHOTRECEIVER snapshot_receiver;
+};
+
+INSTANCE *instance_create(EXARENA *arena, const int *map, int dimension, int tile_size, int visibility_threads, uint16_t serve_port);
+void instance_destroy(INSTANCE *instance);
+EXBOOL instance_attach(INSTANCE *instance);
+void instance_detach(INSTANCE *instance);
+void instance_spawn_crowd(INSTANCE *instance);
+void instance_simulate(INSTANCE *instance, EXGAMEPAD *gamepads, float delta_seconds);
+void instance_visibility(INSTANCE *instance);
+void instance_snapshot(INSTANCE *instance);
+PLAYER instance_interpolate_player(INSTANCE *instance, int index);
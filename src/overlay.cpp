@@ -0,0 +1,138 @@
+#include "overlay.h"
+#include "render.h"
+
+#define OVERLAY_GLYPH_WIDTH 3
+#define OVERLAY_GLYPH_HEIGHT 5
+#define OVERLAY_GRAPH_HEIGHT 48
+#define OVERLAY_HISTOGRAM_BAR_WIDTH 2
+
+#define OVERLAY_TEXT_COLOR RENDER_RAMP(RENDER_RAMP_GREY, 31)
+#define OVERLAY_BACKGROUND_COLOR RENDER_RAMP(RENDER_RAMP_GREY, 0)
+#define OVERLAY_BUDGET_COLOR RENDER_RAMP(RENDER_RAMP_GREY, 18)
+#define OVERLAY_GOOD_COLOR RENDER_RAMP(RENDER_RAMP_GREEN, 31)
+#define OVERLAY_SLOW_COLOR RENDER_RAMP(RENDER_RAMP_YELLOW, 31)
+#define OVERLAY_SPIKE_COLOR RENDER_RAMP(RENDER_RAMP_RED, 31)
+#define OVERLAY_HISTOGRAM_COLOR RENDER_RAMP(RENDER_RAMP_BLUE, 31)
+
+static const char overlay_glyph_characters[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%";
+static const uint16_t overlay_glyphs[] = {
+    0x7B6F, // 0
+    0x2C97, // 1
+    0x73E7, // 2
+    0x73CF, // 3
+    0x5BC9, // 4
+    0x79CF, // 5
+    0x79EF, // 6
+    0x7249, // 7
+    0x7BEF, // 8
+    0x7BCF, // 9
+    0x2BED, // A
+    0x6BAE, // B
+    0x3923, // C
+    0x6B6E, // D
+    0x79A7, // E
+    0x79A4, // F
+    0x396B, // G
+    0x5BED, // H
+    0x7497, // I
+    0x126A, // J
+    0x5BAD, // K
+    0x4927, // L
+    0x5FED, // M
+    0x6B6D, // N
+    0x2B6A, // O
+    0x6BA4, // P
+    0x2B73, // Q
+    0x6BAD, // R
+    0x388E, // S
+    0x7492, // T
+    0x5B6F, // U
+    0x5B6A, // V
+    0x5BFD, // W
+    0x5AAD, // X
+    0x5A92, // Y
+    0x72A7, // Z
+    0x0002, // .
+    0x0410, // :
+    0x12A4, // /
+    0x01C0, // -
+    0x52A5, // %
+};
+
+int overlay_text(EXFRAMEBUFFER *framebuffer, int x, int y, int pixel, const char *format, ...) {
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    int cursor = x;
+    for (const char *c = text; *c; c++) {
+        char character = *c;
+        if (character >= 'a' && character <= 'z') character -= 'a' - 'A';
+        for (int glyph = 0; overlay_glyph_characters[glyph]; glyph++) {
+            if (overlay_glyph_characters[glyph] != character) continue;
+            uint16_t bits = overlay_glyphs[glyph];
+            for (int row = 0; row < OVERLAY_GLYPH_HEIGHT; row++) {
+                for (int column = 0; column < OVERLAY_GLYPH_WIDTH; column++) {
+                    int bit = (OVERLAY_GLYPH_WIDTH * OVERLAY_GLYPH_HEIGHT - 1) - (row * OVERLAY_GLYPH_WIDTH + column);
+                    if (bits & (1 << bit)) {
+                        EXMU_framebuffer_fill(framebuffer, cursor + column * pixel, y + row * pixel, pixel, pixel, OVERLAY_TEXT_COLOR);
+                    }
+                }
+            }
+            break;
+        }
+        cursor += (OVERLAY_GLYPH_WIDTH + 1) * pixel;
+    }
+    return y + (OVERLAY_GLYPH_HEIGHT + 2) * pixel;
+}
+
+void overlay_draw(OVERLAY *overlay, EXFRAMESTATS *stats, EXFRAMEBUFFER *framebuffer, int x, int y) {
+    if (!overlay->visible) return;
+
+    int pixel = framebuffer->width / 480 > 1 ? framebuffer->width / 480 : 1;
+    int graph_width = framebuffer->width / 2 < EX_MAX_FRAME_STATS ? framebuffer->width / 2 : EX_MAX_FRAME_STATS;
+    int graph_height = OVERLAY_GRAPH_HEIGHT * pixel;
+    int bar_width = OVERLAY_HISTOGRAM_BAR_WIDTH * pixel;
+    float budget = overlay->budget_milliseconds > 0.0f ? overlay->budget_milliseconds : 16.667f;
+    float pixels_per_millisecond = graph_height / (2.0f * budget);
+    int size = EXMU_frame_stats_size(stats);
+    if (size > graph_width) size = graph_width;
+
+    EXMU_framebuffer_fill(framebuffer, x, y, graph_width, graph_height, OVERLAY_BACKGROUND_COLOR);
+    for (int age = 0; age < size; age++) {
+        float milliseconds = EXMU_frame_stats_get(stats, age) / 1000000.0f;
+        int height = (int)(milliseconds * pixels_per_millisecond);
+        if (height > graph_height) height = graph_height;
+        if (height < 1) height = 1;
+        uint8_t color = OVERLAY_GOOD_COLOR;
+        if (milliseconds > budget) color = OVERLAY_SLOW_COLOR;
+        if (milliseconds > 2.0f * budget) color = OVERLAY_SPIKE_COLOR;
+        EXMU_framebuffer_fill(framebuffer, x + graph_width - 1 - age, y + graph_height - height, 1, height, color);
+    }
+    EXMU_framebuffer_fill(framebuffer, x, y + graph_height / 2, graph_width, 1, OVERLAY_BUDGET_COLOR);
+
+    uint32_t histogram_max = 1;
+    for (int bucket = 0; bucket < EX_MAX_FRAME_HISTOGRAM; bucket++) {
+        if (stats->histogram[bucket] > histogram_max) histogram_max = stats->histogram[bucket];
+    }
+    int histogram_x = x + graph_width + 4 * pixel;
+    EXMU_framebuffer_fill(framebuffer, histogram_x, y, EX_MAX_FRAME_HISTOGRAM * bar_width, graph_height, OVERLAY_BACKGROUND_COLOR);
+    for (int bucket = 0; bucket < EX_MAX_FRAME_HISTOGRAM; bucket++) {
+        int height = (int)((uint64_t)stats->histogram[bucket] * graph_height / histogram_max);
+        EXMU_framebuffer_fill(framebuffer, histogram_x + bucket * bar_width, y + graph_height - height,
+                              bar_width - 1, height, OVERLAY_HISTOGRAM_COLOR);
+    }
+
+    int text_y = y + graph_height + 2 * pixel;
+    text_y = overlay_text(framebuffer, x, text_y, pixel, "FRAME %.2f MS RES %dX%d",
+                          EXMU_frame_stats_get(stats, 0) / 1000000.0f, framebuffer->width, framebuffer->height);
+    text_y = overlay_text(framebuffer, x, text_y, pixel, "MIN %.2f AVG %.2f MAX %.2f",
+                          stats->min / 1000000.0f, stats->average / 1000000.0f, stats->max / 1000000.0f);
+    text_y = overlay_text(framebuffer, x, text_y, pixel, "P95 %.2f P99 %.2f", stats->p95 / 1000000.0f, stats->p99 / 1000000.0f);
+    text_y = overlay_text(framebuffer, x, text_y, pixel, "RAYS %llu CACHED %llu CELLS %llu",
+                          (unsigned long long)overlay->rays, (unsigned long long)overlay->cached, (unsigned long long)overlay->cells);
+    text_y = overlay_text(framebuffer, x, text_y, pixel, "SNAPSHOT %llu B %.1f US",
+                          (unsigned long long)overlay->snapshot_bytes, overlay->snapshot_microseconds);
+}
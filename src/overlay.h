@@ -0,0 +1,15 @@
+#pragma once
+
+#include "exmu.h"
+
+struct OVERLAY {
+    EXBOOL visible;
+    float budget_milliseconds;
+    uint64_t rays;
+    uint64_t cells;
+    uint64_t cached;
+    uint64_t snapshot_bytes;
+    float snapshot_microseconds;
+};
+
+void overlay_draw(OVERLAY *overlay, EXFRAMESTATS *stats, EXFRAMEBUFFER *framebuffer, int x, int y);
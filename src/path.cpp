@@ -0,0 +1,323 @@
+#include "path.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct PATHQUERY {
+    WORLD *world;
+    int dimension;
+    int goal;
+    int *costs;
+    int *parents;
+    uint64_t *open;
+    uint64_t *closed;
+    PATHNODE *heap;
+    int heap_count;
+    int heap_capacity;
+};
+
+static EXBOOL path_free(PATHQUERY *query, int x, int y) {
+    return !world_solid(query->world, x, y);
+}
+
+static EXBOOL path_bit(uint64_t *bits, int cell) {
+    return (bits[cell / 64] >> (cell % 64)) & 1;
+}
+
+static void path_set_bit(uint64_t *bits, int cell) {
+    bits[cell / 64] |= (uint64_t)1 << (cell % 64);
+}
+
+static int path_distance(int from, int to, int dimension) {
+    int dx = abs(from % dimension - to % dimension);
+    int dy = abs(from / dimension - to / dimension);
+    int diagonal = dx < dy ? dx : dy;
+    int straight = dx + dy - 2 * diagonal;
+    return diagonal * PATH_COST_DIAGONAL + straight * PATH_COST_STRAIGHT;
+}
+
+static EXBOOL path_heap_push(PATHQUERY *query, int cost, int cell) {
+    if (query->heap_count >= query->heap_capacity) return EX_FALSE;
+    PATHNODE *heap = query->heap;
+    int index = query->heap_count++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap[parent].cost <= cost) break;
+        heap[index] = heap[parent];
+        index = parent;
+    }
+    heap[index].cost = cost;
+    heap[index].cell = cell;
+    return EX_TRUE;
+}
+
+static PATHNODE path_heap_pop(PATHQUERY *query) {
+    PATHNODE *heap = query->heap;
+    PATHNODE top = heap[0];
+    PATHNODE last = heap[--query->heap_count];
+    int index = 0;
+    for (;;) {
+        int child = index * 2 + 1;
+        if (child >= query->heap_count) break;
+        if (child + 1 < query->heap_count && heap[child + 1].cost < heap[child].cost) child += 1;
+        if (last.cost <= heap[child].cost) break;
+        heap[index] = heap[child];
+        index = child;
+    }
+    heap[index] = last;
+    return top;
+}
+
+// diagonal moves never cut corners, so a straight run only stops beside an obstacle that ends
+static int path_jump_straight(PATHQUERY *query, int x, int y, int dx, int dy) {
+    for (;;) {
+        if (!path_free(query, x, y)) return -1;
+        int cell = x + y * query->dimension;
+        if (cell == query->goal) return cell;
+        if (dx) {
+            if ((path_free(query, x, y - 1) && !path_free(query, x - dx, y - 1)) ||
+                (path_free(query, x, y + 1) && !path_free(query, x - dx, y + 1))) return cell;
+        } else {
+            if ((path_free(query, x - 1, y) && !path_free(query, x - 1, y - dy)) ||
+                (path_free(query, x + 1, y) && !path_free(query, x + 1, y - dy))) return cell;
+        }
+        x += dx;
+        y += dy;
+    }
+}
+
+static int path_jump(PATHQUERY *query, int x, int y, int dx, int dy) {
+    if (!dx || !dy) return path_jump_straight(query, x, y, dx, dy);
+    for (;;) {
+        if (!path_free(query, x, y)) return -1;
+        int cell = x + y * query->dimension;
+        if (cell == query->goal) return cell;
+        if (path_jump_straight(query, x + dx, y, dx, 0) >= 0 ||
+            path_jump_straight(query, x, y + dy, 0, dy) >= 0) return cell;
+        if (!path_free(query, x + dx, y) || !path_free(query, x, y + dy)) return -1;
+        x += dx;
+        y += dy;
+    }
+}
+
+static int path_neighbors(PATHQUERY *query, int cell, EXINT2 *directions) {
+    int dimension = query->dimension;
+    int x = cell % dimension;
+    int y = cell / dimension;
+    int count = 0;
+
+    int parent = query->parents[cell];
+    if (parent < 0) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (!dx && !dy) continue;
+                if (dx && dy && (!path_free(query, x + dx, y) || !path_free(query, x, y + dy))) continue;
+                directions[count++] = {dx, dy};
+            }
+        }
+        return count;
+    }
+
+    int px = parent % dimension;
+    int py = parent / dimension;
+    int dx = (x > px) - (x < px);
+    int dy = (y > py) - (y < py);
+    if (dx && dy) {
+        EXBOOL horizontal = path_free(query, x + dx, y);
+        EXBOOL vertical = path_free(query, x, y + dy);
+        if (vertical) directions[count++] = {0, dy};
+        if (horizontal) directions[count++] = {dx, 0};
+        if (horizontal && vertical) directions[count++] = {dx, dy};
+    } else if (dx) {
+        EXBOOL next = path_free(query, x + dx, y);
+        EXBOOL up = path_free(query, x, y - 1);
+        EXBOOL down = path_free(query, x, y + 1);
+        if (next) {
+            directions[count++] = {dx, 0};
+            if (up) directions[count++] = {dx, -1};
+            if (down) directions[count++] = {dx, 1};
+        }
+        if (up) directions[count++] = {0, -1};
+        if (down) directions[count++] = {0, 1};
+    } else {
+        EXBOOL next = path_free(query, x, y + dy);
+        EXBOOL left = path_free(query, x - 1, y);
+        EXBOOL right = path_free(query, x + 1, y);
+        if (next) {
+            directions[count++] = {0, dy};
+            if (left) directions[count++] = {-1, dy};
+            if (right) directions[count++] = {1, dy};
+        }
+        if (left) directions[count++] = {-1, 0};
+        if (right) directions[count++] = {1, 0};
+    }
+    return count;
+}
+
+static EXBOOL path_search(PATHFINDER *pathfinder, int start, int goal, PATH *path) {
+    WORLD *world = pathfinder->world;
+    int dimension = world->dimension;
+    int count = dimension * dimension;
+    int words = (count + 63) / 64;
+
+    EXARENA *arena = &pathfinder->arena;
+    EXMU_arena_reset(arena);
+    PATHQUERY query = {};
+    query.world = world;
+    query.dimension = dimension;
+    query.goal = goal;
+    query.costs = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    query.parents = (int *)EXMU_arena_push(arena, count * sizeof(int), 64);
+    query.open = (uint64_t *)EXMU_arena_push(arena, words * sizeof(uint64_t), 64);
+    query.closed = (uint64_t *)EXMU_arena_push(arena, words * sizeof(uint64_t), 64);
+    query.heap_capacity = count;
+    query.heap = (PATHNODE *)EXMU_arena_push(arena, count * sizeof(PATHNODE), 64);
+    if (!query.costs || !query.parents || !query.open || !query.closed || !query.heap) return EX_FALSE;
+    memset(query.open, 0, words * sizeof(uint64_t));
+    memset(query.closed, 0, words * sizeof(uint64_t));
+
+    // costs and parents are only meaningful where the open bit is set
+    query.costs[start] = 0;
+    query.parents[start] = -1;
+    path_set_bit(query.open, start);
+    path_heap_push(&query, path_distance(start, goal, dimension), start);
+
+    while (query.heap_count) {
+        PATHNODE node = path_heap_pop(&query);
+        if (path_bit(query.closed, node.cell)) continue;
+        path_set_bit(query.closed, node.cell);
+        pathfinder->expanded += 1;
+
+        if (node.cell == goal) {
+            int points = 0;
+            for (int cell = goal; cell >= 0; cell = query.parents[cell]) points += 1;
+            if (points > PATH_MAX_POINTS) return EX_FALSE;
+            path->count = points;
+            path->cost = query.costs[goal];
+            for (int cell = goal; cell >= 0; cell = query.parents[cell]) {
+                points -= 1;
+                path->points[points] = {cell % dimension, cell / dimension};
+            }
+            return EX_TRUE;
+        }
+
+        EXINT2 directions[8];
+        int direction_count = path_neighbors(&query, node.cell, directions);
+        int x = node.cell % dimension;
+        int y = node.cell / dimension;
+        for (int index = 0; index < direction_count; index++) {
+            EXINT2 direction = directions[index];
+            int jump = path_jump(&query, x + direction.x, y + direction.y, direction.x, direction.y);
+            if (jump < 0 || path_bit(query.closed, jump)) continue;
+            int cost = query.costs[node.cell] + path_distance(node.cell, jump, dimension);
+            if (path_bit(query.open, jump) && cost >= query.costs[jump]) continue;
+            path_set_bit(query.open, jump);
+            query.costs[jump] = cost;
+            query.parents[jump] = node.cell;
+            if (!path_heap_push(&query, cost + path_distance(jump, goal, dimension), jump)) return EX_FALSE;
+        }
+    }
+    return EX_FALSE;
+}
+
+// the scratch arena one query resets and refills is carved out of the owner's arena
+EXBOOL pathfinder_initialize(PATHFINDER *pathfinder, WORLD *world, EXARENA *arena) {
+    int count = world->dimension * world->dimension;
+    int words = (count + 63) / 64;
+    size_t size = (size_t)count * (2 * sizeof(int) + sizeof(PATHNODE)) + 2 * words * sizeof(uint64_t) + 5 * 64;
+    pathfinder->world = world;
+    pathfinder->arena.base = (uint8_t *)EXMU_arena_push(arena, size, 64);
+    pathfinder->arena.size = pathfinder->arena.base ? size : 0;
+    pathfinder->arena.used = 0;
+    pathfinder_invalidate(pathfinder);
+    return pathfinder->arena.base != 0;
+}
+
+void pathfinder_destroy(PATHFINDER *pathfinder) {
+    pathfinder_invalidate(pathfinder);
+    pathfinder->arena.base = 0;
+    pathfinder->arena.size = 0;
+    pathfinder->arena.used = 0;
+}
+
+void pathfinder_invalidate(PATHFINDER *pathfinder) {
+    for (int index = 0; index < PATH_CACHE_SIZE; index++) pathfinder->cache[index].valid = EX_FALSE;
+}
+
+static int path_clamp(int value, int low, int high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+// a cell that became solid can only break the paths whose bounds it falls inside, one that became
+// free can only shorten a path whose cost is above the shortest detour through it; the rectangle
+// is grown by one because a freed cell also unblocks the diagonals around it
+void pathfinder_world_changed(void *data, WORLD *world, int x, int y, int width, int height, int changes) {
+    PATHFINDER *pathfinder = (PATHFINDER *)data;
+    if (!(changes & WORLD_CHANGED_SOLID)) return;
+    EXBOOL freed = EX_FALSE;
+    for (int cell_y = y; cell_y < y + height && !freed; cell_y++) {
+        for (int cell_x = x; cell_x < x + width && !freed; cell_x++) {
+            if (!world_solid(world, cell_x, cell_y)) freed = EX_TRUE;
+        }
+    }
+    int dimension = world->dimension;
+    int x0 = path_clamp(x - 1, 0, dimension - 1);
+    int y0 = path_clamp(y - 1, 0, dimension - 1);
+    int x1 = path_clamp(x + width, 0, dimension - 1);
+    int y1 = path_clamp(y + height, 0, dimension - 1);
+    for (int index = 0; index < PATH_CACHE_SIZE; index++) {
+        PATHCACHEENTRY *entry = pathfinder->cache + index;
+        if (!entry->valid) continue;
+        if (x <= entry->max.x && y <= entry->max.y && x + width > entry->min.x && y + height > entry->min.y) {
+            entry->valid = EX_FALSE;
+            continue;
+        }
+        if (!freed) continue;
+        int start_x = entry->start % dimension;
+        int start_y = entry->start / dimension;
+        int goal_x = entry->goal % dimension;
+        int goal_y = entry->goal / dimension;
+        int near_start = path_clamp(start_x, x0, x1) + path_clamp(start_y, y0, y1) * dimension;
+        int near_goal = path_clamp(goal_x, x0, x1) + path_clamp(goal_y, y0, y1) * dimension;
+        int detour = path_distance(entry->start, near_start, dimension) + path_distance(near_goal, entry->goal, dimension);
+        if (detour < entry->path.cost) entry->valid = EX_FALSE;
+    }
+}
+
+EXBOOL pathfinder_find(PATHFINDER *pathfinder, EXINT2 start, EXINT2 goal, PATH *path) {
+    WORLD *world = pathfinder->world;
+    pathfinder->queries += 1;
+    if (world_solid(world, start.x, start.y) || world_solid(world, goal.x, goal.y)) return EX_FALSE;
+    int start_cell = start.x + start.y * world->dimension;
+    int goal_cell = goal.x + goal.y * world->dimension;
+
+    // LRU
+    pathfinder->clock += 1;
+    PATHCACHEENTRY *victim = pathfinder->cache;
+    for (int index = 0; index < PATH_CACHE_SIZE; index++) {
+        PATHCACHEENTRY *entry = pathfinder->cache + index;
+        if (entry->valid && entry->start == start_cell && entry->goal == goal_cell) {
+            entry->used = pathfinder->clock;
+            *path = entry->path;
+            pathfinder->hits += 1;
+            return EX_TRUE;
+        }
+        if (victim->valid && (!entry->valid || entry->used < victim->used)) victim = entry;
+    }
+
+    if (!path_search(pathfinder, start_cell, goal_cell, path)) return EX_FALSE;
+    victim->valid = EX_TRUE;
+    victim->start = start_cell;
+    victim->goal = goal_cell;
+    victim->used = pathfinder->clock;
+    victim->min = path->points[0];
+    victim->max = path->points[0];
+    for (int index = 1; index < path->count; index++) {
+        EXINT2 point = path->points[index];
+        if (point.x < victim->min.x) victim->min.x = point.x;
+        if (point.y < victim->min.y) victim->min.y = point.y;
+        if (point.x > victim->max.x) victim->max.x = point.x;
+        if (point.y > victim->max.y) victim->max.y = point.y;
+    }
+    victim->path = *path;
+    return EX_TRUE;
+}
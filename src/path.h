@@ -0,0 +1,50 @@
+#pragma once
+
+#include "exmu.h"
+#include "world.h"
+
+#define PATH_MAX_POINTS 256
+#define PATH_CACHE_SIZE 64
+#define PATH_COST_STRAIGHT 100
+#define PATH_COST_DIAGONAL 141
+
+// jump points from start to goal inclusive, consecutive points are joined by a straight or
+// diagonal run of free cells
+struct PATH {
+    int count;
+    int cost;
+    EXINT2 points[PATH_MAX_POINTS];
+};
+
+struct PATHCACHEENTRY {
+    EXBOOL valid;
+    int start;
+    int goal;
+    uint64_t used;
+    EXINT2 min;
+    EXINT2 max;
+    PATH path;
+};
+
+struct PATHNODE {
+    int cost;
+    int cell;
+};
+
+struct PATHFINDER {
+    WORLD *world;
+    EXARENA arena;
+
+    PATHCACHEENTRY cache[PATH_CACHE_SIZE];
+    uint64_t clock;
+
+    uint64_t queries;
+    uint64_t hits;
+    uint64_t expanded;
+};
+
+EXBOOL pathfinder_initialize(PATHFINDER *pathfinder, WORLD *world, EXARENA *arena);
+void pathfinder_destroy(PATHFINDER *pathfinder);
+void pathfinder_invalidate(PATHFINDER *pathfinder);
+void pathfinder_world_changed(void *data, WORLD *world, int x, int y, int width, int height, int changes);
+EXBOOL pathfinder_find(PATHFINDER *pathfinder, EXINT2 start, EXINT2 goal, PATH *path);
@@ -0,0 +1,365 @@
+#include "raycast.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define P2 M_PI / 2
+#define P3 3 * M_PI / 2
+
+float length(EXFLOAT2 a, EXFLOAT2 b) {
+    return (sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y)));
+}
+
+// doors slide along the face they are hit on; the ray passes where the door has already slid away
+static EXBOOL raycast_door_open(WORLD *world, int map_index, float along) {
+    if (world->map[map_index] != WORLD_DOOR || !world->openings) return EX_FALSE;
+    return along < world->openings[map_index] * world->tile_size;
+}
+
+RAYHIT raycast_ray(WORLD *world, EXFLOAT2 position, float ray_angle, uint64_t *cells) {
+    int tile_size = world->tile_size;
+    int max_depth = world->dimension;
+    EXINT2 map_index_pos;
+    int map_index;
+    int depth_of_field;
+    EXFLOAT2 ray_position;
+    EXFLOAT2 ray_offset;
+
+    // HORIZONTAL CHECK
+    depth_of_field = 0;
+    float horizontal_distance = 1000000.0f;
+    float atan = -1 / tan(ray_angle);
+    if (ray_angle > M_PI) {
+        ray_position.y = (((int)position.y / tile_size) * tile_size) -0.0001;
+        ray_position.x = (position.y - ray_position.y) * atan + position.x;
+        ray_offset.y = -tile_size;
+        ray_offset.x = -ray_offset.y * atan;
+    }
+    if (ray_angle < M_PI) {
+        ray_position.y = (((int)position.y / tile_size) * tile_size) + tile_size;
+        ray_position.x = (position.y - ray_position.y) * atan + position.x;
+        ray_offset.y = tile_size;
+        ray_offset.x = -ray_offset.y * atan;
+    }
+    if (ray_angle == 0 || ray_angle == (float)M_PI) {
+        ray_position = position;
+        depth_of_field = max_depth;
+    }
+    while (depth_of_field < max_depth) {
+        *cells += 1;
+        map_index_pos.x = (int)(ray_position.x) / tile_size;
+        map_index_pos.y = (int)(ray_position.y) / tile_size;
+        map_index = + map_index_pos.x + map_index_pos.y * world->dimension;
+        if (map_index > 0 && map_index < world->dimension * world->dimension && world->map[map_index] != WORLD_EMPTY &&
+            !raycast_door_open(world, map_index, ray_position.x - map_index_pos.x * tile_size)) {
+            horizontal_distance = length(position, ray_position);
+            depth_of_field = max_depth;
+        } else {
+            ray_position.x += ray_offset.x;
+            ray_position.y += ray_offset.y;
+            depth_of_field += 1;
+        }
+    }
+
+    // VERTICAL CHECK
+    depth_of_field = 0;
+    float vertical_distance = 1000000.0f;
+    float ntan = -tan(ray_angle);
+    if (ray_angle > P2 && ray_angle < P3) {
+        ray_position.x = (((int)position.x / tile_size) * tile_size) -0.0001;
+        ray_position.y = (position.x - ray_position.x) * ntan + position.y;
+        ray_offset.x = -tile_size;
+        ray_offset.y = -ray_offset.x * ntan;
+    }
+    if (ray_angle < P2 || ray_angle > P3) {
+        ray_position.x = (((int)position.x / tile_size) * tile_size) + tile_size;
+        ray_position.y = (position.x - ray_position.x) * ntan + position.y;
+        ray_offset.x = tile_size;
+        ray_offset.y = -ray_offset.x * ntan;
+    }
+    if (ray_angle == (float)(P2) || ray_angle == (float)(P3)) {
+        ray_position = position;
+        depth_of_field = max_depth;
+    }
+    while (depth_of_field < max_depth) {
+        *cells += 1;
+        map_index_pos.x = (int)(ray_position.x) / tile_size;
+        map_index_pos.y = (int)(ray_position.y) / tile_size;
+        map_index = + map_index_pos.x + map_index_pos.y * world->dimension;
+        if (map_index > 0 && map_index < world->dimension * world->dimension && world->map[map_index] != WORLD_EMPTY &&
+            !raycast_door_open(world, map_index, ray_position.y - map_index_pos.y * tile_size)) {
+            vertical_distance = length(position, ray_position);
+            depth_of_field = max_depth;
+        } else {
+            ray_position.x += ray_offset.x;
+            ray_position.y += ray_offset.y;
+            depth_of_field += 1;
+        }
+    }
+
+    RAYHIT hit;
+    hit.vertical = vertical_distance < horizontal_distance;
+    hit.distance = hit.vertical ? vertical_distance : horizontal_distance;
+    return hit;
+}
+
+// grid traversal that reports every cell boundary in order, for worlds where a hit does not end the ray
+int raycast_walk_begin(RAYWALK *walk, WORLD *world, EXFLOAT2 position, float ray_angle) {
+    float tile_size = (float)world->tile_size;
+    float direction_x = cosf(ray_angle);
+    float direction_y = sinf(ray_angle);
+    walk->dimension = world->dimension;
+    walk->cell.x = (int)floorf(position.x / tile_size);
+    walk->cell.y = (int)floorf(position.y / tile_size);
+    walk->step.x = direction_x < 0 ? -1 : 1;
+    walk->step.y = direction_y < 0 ? -1 : 1;
+    walk->delta.x = direction_x != 0 ? fabsf(tile_size / direction_x) : 1e30f;
+    walk->delta.y = direction_y != 0 ? fabsf(tile_size / direction_y) : 1e30f;
+    float edge_x = (walk->cell.x + (walk->step.x > 0 ? 1 : 0)) * tile_size;
+    float edge_y = (walk->cell.y + (walk->step.y > 0 ? 1 : 0)) * tile_size;
+    walk->next.x = direction_x != 0 ? (edge_x - position.x) / direction_x : 1e30f;
+    walk->next.y = direction_y != 0 ? (edge_y - position.y) / direction_y : 1e30f;
+    if (walk->cell.x < 0 || walk->cell.y < 0 || walk->cell.x >= walk->dimension || walk->cell.y >= walk->dimension) return -1;
+    return walk->cell.x + walk->cell.y * walk->dimension;
+}
+
+EXBOOL raycast_walk_next(RAYWALK *walk, RAYCROSSING *crossing) {
+    if (walk->next.x < walk->next.y) {
+        crossing->distance = walk->next.x;
+        crossing->vertical = EX_TRUE;
+        walk->next.x += walk->delta.x;
+        walk->cell.x += walk->step.x;
+    } else {
+        crossing->distance = walk->next.y;
+        crossing->vertical = EX_FALSE;
+        walk->next.y += walk->delta.y;
+        walk->cell.y += walk->step.y;
+    }
+    if (walk->cell.x < 0 || walk->cell.y < 0 || walk->cell.x >= walk->dimension || walk->cell.y >= walk->dimension) return EX_FALSE;
+    crossing->cell = walk->cell.x + walk->cell.y * walk->dimension;
+    return EX_TRUE;
+}
+
+EXBOOL raycaster_configure(RAYCASTER *raycaster, int columns, float fov) {
+    int angle_steps = (int)(columns * (2 * M_PI) / fov + 0.5f);
+    if (raycaster->columns == columns && raycaster->angle_steps == angle_steps) return EX_TRUE;
+
+    free(raycaster->column_cosines);
+    free(raycaster->cache);
+    free(raycaster->cache_stamps);
+    raycaster->column_cosines = (float *)malloc(columns * sizeof(float));
+    raycaster->cache = (RAYHIT *)malloc((size_t)RAYCAST_MAX_VIEWS * angle_steps * sizeof(RAYHIT));
+    raycaster->cache_stamps = (uint32_t *)calloc((size_t)RAYCAST_MAX_VIEWS * angle_steps, sizeof(uint32_t));
+    if (!raycaster->column_cosines || !raycaster->cache || !raycaster->cache_stamps) {
+        raycaster->columns = 0;
+        raycaster->angle_steps = 0;
+        return EX_FALSE;
+    }
+
+    raycaster->columns = columns;
+    raycaster->fov = fov;
+    raycaster->angle_steps = angle_steps;
+    raycaster->angle_step = (float)(2 * M_PI / angle_steps);
+    for (int column = 0; column < columns; column++) {
+        raycaster->column_cosines[column] = cos((column - columns / 2) * raycaster->angle_step);
+    }
+    for (int index = 0; index < RAYCAST_MAX_VIEWS; index++) {
+        RAYCACHE *cache = raycaster->caches + index;
+        cache->position.x = 0.0f;
+        cache->position.y = 0.0f;
+        cache->revision = 0;
+        cache->stamp = 1;
+        cache->used = 0;
+        cache->hits = raycaster->cache + (size_t)index * angle_steps;
+        cache->stamps = raycaster->cache_stamps + (size_t)index * angle_steps;
+    }
+    return EX_TRUE;
+}
+
+// the buffers follow the column count, which changes with the resolution, so they stay on the heap
+void raycaster_destroy(RAYCASTER *raycaster) {
+    free(raycaster->column_cosines);
+    free(raycaster->cache);
+    free(raycaster->cache_stamps);
+    raycaster->column_cosines = 0;
+    raycaster->cache = 0;
+    raycaster->cache_stamps = 0;
+    raycaster->columns = 0;
+    raycaster->angle_steps = 0;
+}
+
+static void raycaster_cache_invalidate(RAYCASTER *raycaster, RAYCACHE *cache) {
+    cache->stamp += 1;
+    if (cache->stamp == 0) {
+        memset(cache->stamps, 0, raycaster->angle_steps * sizeof(uint32_t));
+        cache->stamp = 1;
+    }
+}
+
+void raycaster_invalidate(RAYCASTER *raycaster) {
+    if (!raycaster->angle_steps) return;
+    for (int index = 0; index < RAYCAST_MAX_VIEWS; index++) raycaster_cache_invalidate(raycaster, raycaster->caches + index);
+}
+
+// only rays inside the angle the dirty rectangle subtends from the cache position can change
+static void raycaster_cache_changed(RAYCASTER *raycaster, RAYCACHE *cache, WORLD *world, int x, int y, int width, int height) {
+    cache->revision = world->revision;
+    EXFLOAT2 position = cache->position;
+    float x0 = (float)x * world->tile_size - position.x;
+    float y0 = (float)y * world->tile_size - position.y;
+    float x1 = x0 + (float)width * world->tile_size;
+    float y1 = y0 + (float)height * world->tile_size;
+    if (x0 <= 0 && x1 >= 0 && y0 <= 0 && y1 >= 0) {
+        raycaster_cache_invalidate(raycaster, cache);
+        return;
+    }
+    float center = atan2f((y0 + y1) / 2, (x0 + x1) / 2);
+    float corners[4][2] = {{x0, y0}, {x1, y0}, {x0, y1}, {x1, y1}};
+    float low = 0.0f;
+    float high = 0.0f;
+    for (int corner = 0; corner < 4; corner++) {
+        float delta = atan2f(corners[corner][1], corners[corner][0]) - center;
+        if (delta > M_PI) delta -= 2 * M_PI;
+        if (delta < -M_PI) delta += 2 * M_PI;
+        if (delta < low) low = delta;
+        if (delta > high) high = delta;
+    }
+    int first = (int)floorf((center + low) / raycaster->angle_step) - 1;
+    int last = (int)ceilf((center + high) / raycaster->angle_step) + 1;
+    if (last - first >= raycaster->angle_steps) {
+        raycaster_cache_invalidate(raycaster, cache);
+        return;
+    }
+    for (int step = first; step <= last; step++) {
+        int index = step % raycaster->angle_steps;
+        if (index < 0) index += raycaster->angle_steps;
+        cache->stamps[index] = 0;
+    }
+}
+
+void raycaster_world_changed(void *data, WORLD *world, int x, int y, int width, int height, int changes) {
+    RAYCASTER *raycaster = (RAYCASTER *)data;
+    if (!raycaster->angle_steps) return;
+    // a cache that already missed an edit is dropped when it is next looked up
+    for (int index = 0; index < RAYCAST_MAX_VIEWS; index++) {
+        RAYCACHE *cache = raycaster->caches + index;
+        if (cache->revision + 1 == world->revision) raycaster_cache_changed(raycaster, cache, world, x, y, width, height);
+    }
+}
+
+static RAYCACHE *raycaster_cache_find(RAYCASTER *raycaster, EXFLOAT2 position) {
+    for (int index = 0; index < RAYCAST_MAX_VIEWS; index++) {
+        RAYCACHE *cache = raycaster->caches + index;
+        if (cache->position.x == position.x && cache->position.y == position.y) return cache;
+    }
+    return 0;
+}
+
+// the cache for this position, or the least recently used one no view has this frame taken over for
+// it, 0 when every cache already serves a view
+static RAYCACHE *raycaster_cache(RAYCASTER *raycaster, WORLD *world, EXFLOAT2 position) {
+    RAYCACHE *cache = raycaster_cache_find(raycaster, position);
+    if (!cache) {
+        for (int index = 0; index < RAYCAST_MAX_VIEWS; index++) {
+            RAYCACHE *candidate = raycaster->caches + index;
+            if (candidate->used != raycaster->frame && (!cache || candidate->used < cache->used)) cache = candidate;
+        }
+        if (!cache) return 0;
+        cache->position = position;
+        raycaster_cache_invalidate(raycaster, cache);
+        cache->revision = world->revision;
+    } else if (cache->revision != world->revision) {
+        raycaster_cache_invalidate(raycaster, cache);
+        cache->revision = world->revision;
+    }
+    cache->used = raycaster->frame;
+    return cache;
+}
+
+void raycaster_cast(RAYCASTER *raycaster, WORLD *world, EXFLOAT2 position, float angle, RAYHIT *hits) {
+    RAYVIEW view = {position, angle, hits};
+    raycaster_cast_views(raycaster, world, &view, 1);
+}
+
+static void raycaster_column(RAYCASTER *raycaster, RAYHIT *hit, RAYHIT ray, int column) {
+    hit->distance = ray.distance * raycaster->column_cosines[column];
+    hit->vertical = ray.vertical;
+}
+
+// each view keeps the rotation cache of its position across frames and views on the same spot share
+// it. the caches of positions still in view are claimed before any is taken over, so a view that moved
+// never evicts one another view is about to use, and a view past the caches is cast without one.
+// cached columns are copied view by view, the misses are cast column by column across the views
+void raycaster_cast_views(RAYCASTER *raycaster, WORLD *world, RAYVIEW *views, int view_count) {
+    raycaster->rays = 0;
+    raycaster->cells = 0;
+    raycaster->cached = 0;
+    if (!raycaster->angle_steps) return;
+    raycaster->frame += 1;
+    for (int view = 0; view < view_count; view++) {
+        RAYCACHE *cache = raycaster_cache_find(raycaster, views[view].position);
+        if (cache) cache->used = raycaster->frame;
+    }
+
+    int angle_steps = raycaster->angle_steps;
+    int columns = raycaster->columns;
+    for (int batch = 0; batch < view_count; batch += RAYCAST_MAX_VIEWS) {
+        RAYVIEW *batch_views = views + batch;
+        int batch_count = view_count - batch < RAYCAST_MAX_VIEWS ? view_count - batch : RAYCAST_MAX_VIEWS;
+        RAYCACHE *caches[RAYCAST_MAX_VIEWS];
+        int firsts[RAYCAST_MAX_VIEWS];
+        int lows[RAYCAST_MAX_VIEWS];
+        int highs[RAYCAST_MAX_VIEWS];
+        int low = columns;
+        int high = -1;
+
+        // CACHED
+        for (int view = 0; view < batch_count; view++) {
+            RAYCACHE *cache = raycaster_cache(raycaster, world, batch_views[view].position);
+            RAYHIT *hits = batch_views[view].hits;
+            caches[view] = cache;
+            firsts[view] = (int)floorf(batch_views[view].angle / raycaster->angle_step + 0.5f) - columns / 2;
+            lows[view] = columns;
+            highs[view] = -1;
+            for (int column = 0; column < columns; column++) {
+                int index = (firsts[view] + column) % angle_steps;
+                if (index < 0) index += angle_steps;
+                if (cache && cache->stamps[index] == cache->stamp) {
+                    raycaster_column(raycaster, hits + column, cache->hits[index], column);
+                    raycaster->cached += 1;
+                } else {
+                    hits[column].distance = -1.0f;
+                    if (column < lows[view]) lows[view] = column;
+                    highs[view] = column;
+                }
+            }
+            if (lows[view] < low) low = lows[view];
+            if (highs[view] > high) high = highs[view];
+        }
+
+        // MISSED
+        for (int column = low; column <= high; column++) {
+            for (int view = 0; view < batch_count; view++) {
+                RAYHIT *hit = batch_views[view].hits + column;
+                if (column < lows[view] || column > highs[view] || hit->distance >= 0.0f) continue;
+                int index = (firsts[view] + column) % angle_steps;
+                if (index < 0) index += angle_steps;
+
+                // a view sharing the cache may have cast this step already in this pass
+                RAYCACHE *cache = caches[view];
+                RAYHIT ray;
+                if (cache && cache->stamps[index] == cache->stamp) {
+                    ray = cache->hits[index];
+                    raycaster->cached += 1;
+                } else {
+                    ray = raycast_ray(world, batch_views[view].position, index * raycaster->angle_step, &raycaster->cells);
+                    raycaster->rays += 1;
+                    if (cache) {
+                        cache->hits[index] = ray;
+                        cache->stamps[index] = cache->stamp;
+                    }
+                }
+                raycaster_column(raycaster, hit, ray, column);
+            }
+        }
+    }
+}
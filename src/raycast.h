@@ -0,0 +1,69 @@
+#pragma once
+
+#include "exmu.h"
+#include "world.h"
+
+struct RAYHIT {
+    float distance;
+    EXBOOL vertical;
+};
+
+#define RAYCAST_MAX_VIEWS 16
+
+struct RAYCROSSING {
+    float distance;
+    EXBOOL vertical;
+    int cell;
+};
+
+struct RAYWALK {
+    int dimension;
+    EXINT2 cell;
+    EXINT2 step;
+    EXFLOAT2 next;
+    EXFLOAT2 delta;
+};
+
+struct RAYVIEW {
+    EXFLOAT2 position;
+    float angle;
+    RAYHIT *hits;
+};
+
+// the rays cast from one position, indexed by angle step, so a view that only turns reuses them
+struct RAYCACHE {
+    EXFLOAT2 position;
+    uint32_t revision;
+    uint32_t stamp;
+    uint64_t used;
+    RAYHIT *hits;
+    uint32_t *stamps;
+};
+
+// cache and cache_stamps back one RAYCACHE per view, views standing on the same spot share one
+struct RAYCASTER {
+    int columns;
+    float fov;
+    int angle_steps;
+    float angle_step;
+    float *column_cosines;
+
+    RAYHIT *cache;
+    uint32_t *cache_stamps;
+    RAYCACHE caches[RAYCAST_MAX_VIEWS];
+    uint64_t frame;
+
+    uint64_t rays;
+    uint64_t cells;
+    uint64_t cached;
+};
+
+RAYHIT raycast_ray(WORLD *world, EXFLOAT2 position, float ray_angle, uint64_t *cells);
+int raycast_walk_begin(RAYWALK *walk, WORLD *world, EXFLOAT2 position, float ray_angle);
+EXBOOL raycast_walk_next(RAYWALK *walk, RAYCROSSING *crossing);
+EXBOOL raycaster_configure(RAYCASTER *raycaster, int columns, float fov);
+void raycaster_destroy(RAYCASTER *raycaster);
+void raycaster_invalidate(RAYCASTER *raycaster);
+void raycaster_world_changed(void *data, WORLD *world, int x, int y, int width, int height, int changes);
+void raycaster_cast(RAYCASTER *raycaster, WORLD *world, EXFLOAT2 position, float angle, RAYHIT *hits);
+void raycaster_cast_views(RAYCASTER *raycaster, WORLD *world, RAYVIEW *views, int view_count);
@@ -0,0 +1,140 @@
+#include "render.h"
+#include <string.h>
+
+static const uint32_t render_ramps[RENDER_RAMP_COUNT] = {
+    0xFFFFFF, // GREY
+    0xE63333, // RED
+    0x33CC33, // GREEN
+    0x4D80E6, // BLUE
+    0xE6CC33, // YELLOW
+    0xC2A06E, // SAND
+    0x5A963C, // GRASS
+    0x87B4EB, // SKY
+};
+
+void render_initialize(RENDERER *renderer, EXFRAMEBUFFER *framebuffer, int tile_size) {
+    // PALETTE
+    for (int index = 0; index < 256; index++) {
+        uint32_t base = render_ramps[(index / RENDER_RAMP_SHADES) % RENDER_RAMP_COUNT];
+        int shade = index % RENDER_RAMP_SHADES + 1;
+        uint32_t r = ((base >> 16) & 0xFF) * shade / RENDER_RAMP_SHADES;
+        uint32_t g = ((base >> 8) & 0xFF) * shade / RENDER_RAMP_SHADES;
+        uint32_t b = (base & 0xFF) * shade / RENDER_RAMP_SHADES;
+        framebuffer->palette[index] = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+
+    // COLORMAPS
+    for (int light = 0; light < RENDER_LIGHT_LEVELS; light++) {
+        for (int band = 0; band < RENDER_DISTANCE_BANDS; band++) {
+            float fog = 1.0f - RENDER_FOG_DARKEN * band / (RENDER_DISTANCE_BANDS - 1);
+            float scale = (float)(light + 1) / RENDER_LIGHT_LEVELS * fog;
+            for (int index = 0; index < 256; index++) {
+                int ramp = index / RENDER_RAMP_SHADES;
+                int shade = (int)((index % RENDER_RAMP_SHADES + 1) * scale + 0.5f) - 1;
+                if (shade < 0) shade = 0;
+                renderer->colormaps[light][band][index] = RENDER_RAMP(ramp, shade);
+            }
+        }
+    }
+    renderer->band_distance = tile_size * 0.5f;
+}
+
+void render_walls(RENDERER *renderer, EXFRAMEBUFFER *framebuffer, RAYHIT *hits, int x, int columns, int tile_size) {
+    int height = framebuffer->height;
+    if (x < 0 || x + columns > framebuffer->width) return;
+    for (int column = 0; column < columns; column++) {
+        float line_height = (tile_size * height) / hits[column].distance;
+        if (line_height > height) line_height = height;
+        int line_offset = (int)((height - line_height) / 2);
+        int line_end = line_offset + (int)line_height;
+        int band = (int)(hits[column].distance / renderer->band_distance);
+        if (band >= RENDER_DISTANCE_BANDS) band = RENDER_DISTANCE_BANDS - 1;
+        int light = hits[column].vertical ? RENDER_VERTICAL_WALL_LIGHT : RENDER_HORIZONTAL_WALL_LIGHT;
+        uint8_t color = renderer->colormaps[light][band][RENDER_WALL_COLOR];
+        memset(framebuffer->indices + (x + column) * height + line_offset, color, line_end - line_offset);
+    }
+}
+
+static int render_band(RENDERER *renderer, float distance) {
+    int band = (int)(distance / renderer->band_distance);
+    return band < RENDER_DISTANCE_BANDS ? band : RENDER_DISTANCE_BANDS - 1;
+}
+
+void render_cells(RENDERER *renderer, EXFRAMEBUFFER *framebuffer, RAYCASTER *raycaster, WORLD *world,
+                  EXFLOAT2 position, float angle, int x) {
+    int height = framebuffer->height;
+    int columns = raycaster->columns;
+    if (x < 0 || x + columns > framebuffer->width) return;
+
+    float eye = world->tile_size / 2.0f;
+    float horizon = height / 2.0f;
+    int center = (int)floorf(angle / raycaster->angle_step + 0.5f);
+    for (int column = 0; column < columns; column++) {
+        float ray_angle = (center - columns / 2 + column) * raycaster->angle_step;
+        float cosine = raycaster->column_cosines[column];
+        uint8_t *pixels = framebuffer->indices + (x + column) * height;
+
+        RAYWALK walk;
+        int cell = raycast_walk_begin(&walk, world, position, ray_angle);
+        raycaster->rays += 1;
+        if (cell < 0) {
+            memset(pixels, RENDER_CLEAR_COLOR, height);
+            continue;
+        }
+
+        // rows [top, bottom) are still uncovered; everything drawn front to back shrinks the span
+        int top = 0;
+        int bottom = height;
+        WORLDCELL current = world_cell(world, cell);
+        RAYCROSSING crossing;
+        while (top < bottom) {
+            EXBOOL more = raycast_walk_next(&walk, &crossing);
+            float distance = more ? crossing.distance * cosine : 1e30f;
+            float scale = height / distance;
+            int band = render_band(renderer, distance);
+            raycaster->cells += 1;
+
+            // FLOOR AND CEILING OF THE CURRENT CELL
+            if (current.floor < eye) {
+                int row = (int)(horizon + (eye - current.floor) * scale);
+                if (row < top) row = top;
+                if (row < bottom) {
+                    uint8_t color = current.floor > 0 ? RENDER_PLATFORM_COLOR : RENDER_FLOOR_COLOR;
+                    memset(pixels + row, renderer->colormaps[RENDER_LIGHT_LEVELS - 1][band][color], bottom - row);
+                    bottom = row;
+                }
+            }
+            if (current.ceiling > eye) {
+                int row = (int)(horizon - (current.ceiling - eye) * scale);
+                if (row > bottom) row = bottom;
+                if (row > top) {
+                    memset(pixels + top, RENDER_CEILING_COLOR, row - top);
+                    top = row;
+                }
+            }
+            if (!more || top >= bottom) break;
+
+            // STEP FACES AT THE BOUNDARY
+            WORLDCELL next = world_cell(world, crossing.cell);
+            int light = crossing.vertical ? RENDER_VERTICAL_WALL_LIGHT : RENDER_HORIZONTAL_WALL_LIGHT;
+            uint8_t color = renderer->colormaps[light][band][RENDER_WALL_COLOR];
+            if (next.floor > current.floor) {
+                int row = (int)(horizon - (next.floor - eye) * scale);
+                if (row < top) row = top;
+                if (row < bottom) {
+                    memset(pixels + row, color, bottom - row);
+                    bottom = row;
+                }
+            }
+            if (next.ceiling < current.ceiling) {
+                int row = (int)(horizon - (next.ceiling - eye) * scale);
+                if (row > bottom) row = bottom;
+                if (row > top) {
+                    memset(pixels + top, color, row - top);
+                    top = row;
+                }
+            }
+            current = next;
+        }
+    }
+}
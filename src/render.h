@@ -0,0 +1,40 @@
+#pragma once
+
+#include "exmu.h"
+#include "raycast.h"
+
+#define RENDER_RAMP_SHADES 32
+#define RENDER_RAMP(ramp, shade) ((uint8_t)((ramp) * RENDER_RAMP_SHADES + (shade)))
+#define RENDER_LIGHT_LEVELS 8
+#define RENDER_DISTANCE_BANDS 32
+#define RENDER_FOG_DARKEN 0.75f
+
+enum {
+    RENDER_RAMP_GREY,
+    RENDER_RAMP_RED,
+    RENDER_RAMP_GREEN,
+    RENDER_RAMP_BLUE,
+    RENDER_RAMP_YELLOW,
+    RENDER_RAMP_SAND,
+    RENDER_RAMP_GRASS,
+    RENDER_RAMP_SKY,
+    RENDER_RAMP_COUNT,
+};
+
+#define RENDER_CLEAR_COLOR RENDER_RAMP(RENDER_RAMP_GREY, 2)
+#define RENDER_WALL_COLOR RENDER_RAMP(RENDER_RAMP_GREY, 12)
+#define RENDER_FLOOR_COLOR RENDER_CLEAR_COLOR
+#define RENDER_CEILING_COLOR RENDER_CLEAR_COLOR
+#define RENDER_PLATFORM_COLOR RENDER_RAMP(RENDER_RAMP_SAND, 10)
+#define RENDER_VERTICAL_WALL_LIGHT (RENDER_LIGHT_LEVELS - 1)
+#define RENDER_HORIZONTAL_WALL_LIGHT (RENDER_LIGHT_LEVELS / 2 - 1)
+
+struct RENDERER {
+    float band_distance;
+    uint8_t colormaps[RENDER_LIGHT_LEVELS][RENDER_DISTANCE_BANDS][256];
+};
+
+void render_initialize(RENDERER *renderer, EXFRAMEBUFFER *framebuffer, int tile_size);
+void render_cells(RENDERER *renderer, EXFRAMEBUFFER *framebuffer, RAYCASTER *raycaster, WORLD *world,
+                  EXFLOAT2 position, float angle, int x);
+void render_walls(RENDERER *renderer, EXFRAMEBUFFER *framebuffer, RAYHIT *hits, int x, int columns, int tile_size);
@@ -0,0 +1,45 @@
+#include "resolution.h"
+
+#define RESOLUTION_DOWN_THRESHOLD 0.9f
+#define RESOLUTION_UP_THRESHOLD 0.6f
+#define RESOLUTION_DOWN_FRAMES 4
+#define RESOLUTION_UP_FRAMES 60
+
+void resolution_update(RESOLUTION *resolution, float work_milliseconds, EXINT2 window_size) {
+    if (window_size.x < 1 || window_size.y < 1) return;
+    resolution->max_columns = window_size.x;
+    resolution->min_columns = window_size.x / 8 > 32 ? window_size.x / 8 : 32;
+    if (resolution->min_columns > resolution->max_columns) resolution->min_columns = resolution->max_columns;
+    if (!resolution->columns) resolution->columns = resolution->max_columns;
+
+    if (resolution->work_milliseconds <= 0.0f) resolution->work_milliseconds = work_milliseconds;
+    resolution->work_milliseconds += (work_milliseconds - resolution->work_milliseconds) * 0.1f;
+
+    float budget = resolution->budget_milliseconds > 0.0f ? resolution->budget_milliseconds : 1000.0f / 60.0f;
+    if (resolution->work_milliseconds > budget * RESOLUTION_DOWN_THRESHOLD) {
+        resolution->frames_over_budget += 1;
+        resolution->frames_under_budget = 0;
+    } else if (resolution->work_milliseconds < budget * RESOLUTION_UP_THRESHOLD) {
+        resolution->frames_under_budget += 1;
+        resolution->frames_over_budget = 0;
+    } else {
+        resolution->frames_over_budget = 0;
+        resolution->frames_under_budget = 0;
+    }
+
+    if (resolution->frames_over_budget >= RESOLUTION_DOWN_FRAMES) {
+        resolution->columns = (int)(resolution->columns * 0.8f);
+        resolution->frames_over_budget = 0;
+        resolution->work_milliseconds = 0.0f;
+    }
+    if (resolution->frames_under_budget >= RESOLUTION_UP_FRAMES) {
+        resolution->columns = (int)(resolution->columns * 1.1f) + 1;
+        resolution->frames_under_budget = 0;
+        resolution->work_milliseconds = 0.0f;
+    }
+
+    if (resolution->columns < resolution->min_columns) resolution->columns = resolution->min_columns;
+    if (resolution->columns > resolution->max_columns) resolution->columns = resolution->max_columns;
+    resolution->rows = resolution->columns * window_size.y / window_size.x;
+    if (resolution->rows < 1) resolution->rows = 1;
+}
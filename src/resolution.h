@@ -0,0 +1,16 @@
+#pragma once
+
+#include "exmu.h"
+
+struct RESOLUTION {
+    int min_columns;
+    int max_columns;
+    int columns;
+    int rows;
+    float budget_milliseconds;
+    float work_milliseconds;
+    int frames_over_budget;
+    int frames_under_budget;
+};
+
+void resolution_update(RESOLUTION *resolution, float work_milliseconds, EXINT2 window_size);
@@ -0,0 +1,361 @@
+#include "snapshot.h"
+#include <math.h>
+#include <string.h>
+
+struct SNAPSHOTBITS {
+    uint8_t *data;
+    int capacity;
+    int size;
+    uint64_t scratch;
+    int scratch_bits;
+    EXBOOL overflow;
+};
+
+static void snapshot_write(SNAPSHOTBITS *bits, uint32_t value, int count) {
+    bits->scratch |= (uint64_t)(value & (uint32_t)(((uint64_t)1 << count) - 1)) << bits->scratch_bits;
+    bits->scratch_bits += count;
+    while (bits->scratch_bits >= 8) {
+        if (bits->size < bits->capacity) bits->data[bits->size++] = (uint8_t)bits->scratch;
+        else bits->overflow = EX_TRUE;
+        bits->scratch >>= 8;
+        bits->scratch_bits -= 8;
+    }
+}
+
+static void snapshot_flush(SNAPSHOTBITS *bits) {
+    if (bits->scratch_bits) snapshot_write(bits, 0, 8 - bits->scratch_bits);
+}
+
+static int snapshot_written(SNAPSHOTBITS *bits) {
+    return bits->size * 8 + bits->scratch_bits;
+}
+
+static uint32_t snapshot_read(SNAPSHOTBITS *bits, int count) {
+    while (bits->scratch_bits < count) {
+        if (bits->size < bits->capacity) bits->scratch |= (uint64_t)bits->data[bits->size++] << bits->scratch_bits;
+        else bits->overflow = EX_TRUE;
+        bits->scratch_bits += 8;
+    }
+    uint32_t value = (uint32_t)(bits->scratch & (((uint64_t)1 << count) - 1));
+    bits->scratch >>= count;
+    bits->scratch_bits -= count;
+    return value;
+}
+
+static uint32_t snapshot_zigzag(int value) {
+    return value < 0 ? ((uint32_t)(-value) << 1) - 1 : (uint32_t)value << 1;
+}
+
+static int snapshot_unzigzag(uint32_t value) {
+    return (value & 1) ? -(int)((value + 1) >> 1) : (int)(value >> 1);
+}
+
+static int snapshot_position_bits(WORLD *world) {
+    uint32_t extent = (uint32_t)(world->dimension * world->tile_size * SNAPSHOT_POSITION_SCALE);
+    int bits = 1;
+    while (bits < 31 && ((uint32_t)1 << bits) <= extent) bits += 1;
+    return bits;
+}
+
+static void snapshot_empty(SNAPSHOT *snapshot) {
+    memset(snapshot, 0, sizeof(SNAPSHOT));
+    snapshot->tick = SNAPSHOT_NO_TICK;
+}
+
+static EXBOOL snapshot_equal(SNAPSHOTENTITY *a, SNAPSHOTENTITY *b) {
+    if (a->active != b->active) return EX_FALSE;
+    if (!a->active) return EX_TRUE;
+    return a->x == b->x && a->y == b->y && a->angle == b->angle;
+}
+
+static void snapshot_write_coordinate(SNAPSHOTBITS *bits, int value, int baseline, EXBOOL delta, int position_bits) {
+    if (!delta) {
+        snapshot_write(bits, value, position_bits);
+        return;
+    }
+    uint32_t zigzag = snapshot_zigzag(value - baseline);
+    snapshot_write(bits, zigzag != 0, 1);
+    if (!zigzag) return;
+    EXBOOL small = zigzag < (1u << SNAPSHOT_SMALL_DELTA_BITS);
+    snapshot_write(bits, small, 1);
+    if (small) snapshot_write(bits, zigzag, SNAPSHOT_SMALL_DELTA_BITS);
+    else snapshot_write(bits, value, position_bits);
+}
+
+static int snapshot_read_coordinate(SNAPSHOTBITS *bits, int baseline, EXBOOL delta, int position_bits) {
+    if (!delta) return snapshot_read(bits, position_bits);
+    if (!snapshot_read(bits, 1)) return baseline;
+    if (snapshot_read(bits, 1)) return baseline + snapshot_unzigzag(snapshot_read(bits, SNAPSHOT_SMALL_DELTA_BITS));
+    return snapshot_read(bits, position_bits);
+}
+
+// entities that would not fit keep their baseline state in sent and go out in a later packet
+static int snapshot_encode(SNAPSHOTSERVER *server, SNAPSHOTCLIENT *client, SNAPSHOT *baseline, SNAPSHOT *sent, uint8_t *data) {
+    SNAPSHOT *current = &server->current;
+    int door_count = server->world->door_count;
+    int position_bits = server->position_bits;
+    int entity_bits = 3 + SNAPSHOT_INDEX_BITS + 2 * (2 + position_bits) + 1 + SNAPSHOT_ANGLE_BITS;
+
+    SNAPSHOTBITS bits = {};
+    bits.data = data;
+    bits.capacity = EX_MAX_PACKET_SIZE;
+    snapshot_write(&bits, SNAPSHOT_PACKET_STATE, 8);
+    snapshot_write(&bits, current->tick, 32);
+    snapshot_write(&bits, baseline->tick, 32);
+    snapshot_write(&bits, server->entity_count, SNAPSHOT_INDEX_BITS + 1);
+    snapshot_write(&bits, door_count, 8);
+
+    // DOORS
+    memcpy(sent, baseline, sizeof(SNAPSHOT));
+    sent->tick = current->tick;
+    for (int door = 0; door < door_count; door++) {
+        EXBOOL changed = current->doors[door] != baseline->doors[door];
+        snapshot_write(&bits, changed, 1);
+        if (changed) snapshot_write(&bits, current->doors[door], 8);
+        sent->doors[door] = current->doors[door];
+    }
+
+    // ENTITIES
+    int previous = -1;
+    for (int index = 0; index < server->entity_count; index++) {
+        SNAPSHOTENTITY entity = current->entities[index];
+        if (entity.active && client->visibility) {
+            int x = (int)(entity.x / SNAPSHOT_POSITION_SCALE) / server->world->tile_size;
+            int y = (int)(entity.y / SNAPSHOT_POSITION_SCALE) / server->world->tile_size;
+            if (!fov_visible(client->visibility, x, y)) entity.active = EX_FALSE;
+        }
+        SNAPSHOTENTITY *base = baseline->entities + index;
+        if (snapshot_equal(&entity, base)) continue;
+        if (snapshot_written(&bits) + entity_bits + 1 > EX_MAX_PACKET_SIZE * 8) break;
+
+        int gap = index - previous - 1;
+        snapshot_write(&bits, 1, 1);
+        if (gap < (1 << SNAPSHOT_SMALL_GAP_BITS)) {
+            snapshot_write(&bits, 0, 1);
+            snapshot_write(&bits, gap, SNAPSHOT_SMALL_GAP_BITS);
+        } else {
+            snapshot_write(&bits, 1, 1);
+            snapshot_write(&bits, gap, SNAPSHOT_INDEX_BITS);
+        }
+        previous = index;
+
+        snapshot_write(&bits, entity.active, 1);
+        if (entity.active) {
+            EXBOOL delta = base->active;
+            snapshot_write_coordinate(&bits, entity.x, base->x, delta, position_bits);
+            snapshot_write_coordinate(&bits, entity.y, base->y, delta, position_bits);
+            EXBOOL turned = !delta || entity.angle != base->angle;
+            if (delta) snapshot_write(&bits, turned, 1);
+            if (turned) snapshot_write(&bits, entity.angle, SNAPSHOT_ANGLE_BITS);
+        } else {
+            entity.x = 0;
+            entity.y = 0;
+            entity.angle = 0;
+        }
+        sent->entities[index] = entity;
+    }
+    snapshot_write(&bits, 0, 1);
+    snapshot_flush(&bits);
+    return bits.overflow ? 0 : bits.size;
+}
+
+// decodes in place over the target slot, the server never deltas against a tick a full history
+// window old so the baseline always lives in another slot
+static EXBOOL snapshot_decode(SNAPSHOTRECEIVER *receiver, uint8_t *data, int size, uint32_t *decoded_tick) {
+    SNAPSHOTBITS bits = {};
+    bits.data = data;
+    bits.capacity = size;
+    if (snapshot_read(&bits, 8) != SNAPSHOT_PACKET_STATE) return EX_FALSE;
+    uint32_t tick = snapshot_read(&bits, 32);
+    uint32_t baseline_tick = snapshot_read(&bits, 32);
+    int entity_count = snapshot_read(&bits, SNAPSHOT_INDEX_BITS + 1);
+    int door_count = snapshot_read(&bits, 8);
+    if (entity_count > SNAPSHOT_MAX_ENTITIES || door_count > WORLD_MAX_DOORS || tick == SNAPSHOT_NO_TICK) return EX_FALSE;
+
+    SNAPSHOT *baseline = receiver->history + (baseline_tick % SNAPSHOT_HISTORY);
+    SNAPSHOT *decoded = receiver->history + (tick % SNAPSHOT_HISTORY);
+    if (baseline_tick != SNAPSHOT_NO_TICK && (baseline->tick != baseline_tick || baseline == decoded)) return EX_FALSE;
+    if (decoded->tick == tick) return EX_FALSE;
+
+    SNAPSHOT *snapshot = decoded;
+    if (baseline_tick == SNAPSHOT_NO_TICK) snapshot_empty(snapshot);
+    else memcpy(snapshot, baseline, sizeof(SNAPSHOT));
+    snapshot->tick = SNAPSHOT_NO_TICK;
+
+    for (int door = 0; door < door_count; door++) {
+        if (snapshot_read(&bits, 1)) snapshot->doors[door] = (uint8_t)snapshot_read(&bits, 8);
+    }
+
+    int position_bits = receiver->position_bits;
+    int index = -1;
+    while (snapshot_read(&bits, 1)) {
+        if (snapshot_read(&bits, 1)) index += 1 + snapshot_read(&bits, SNAPSHOT_INDEX_BITS);
+        else index += 1 + snapshot_read(&bits, SNAPSHOT_SMALL_GAP_BITS);
+        if (index >= entity_count || bits.overflow) return EX_FALSE;
+
+        SNAPSHOTENTITY *entity = snapshot->entities + index;
+        if (snapshot_read(&bits, 1)) {
+            EXBOOL delta = entity->active;
+            entity->x = snapshot_read_coordinate(&bits, entity->x, delta, position_bits);
+            entity->y = snapshot_read_coordinate(&bits, entity->y, delta, position_bits);
+            if (!delta || snapshot_read(&bits, 1)) entity->angle = snapshot_read(&bits, SNAPSHOT_ANGLE_BITS);
+            entity->active = EX_TRUE;
+        } else {
+            memset(entity, 0, sizeof(SNAPSHOTENTITY));
+        }
+    }
+    if (bits.overflow) return EX_FALSE;
+
+    snapshot->tick = tick;
+    *decoded_tick = tick;
+    receiver->entity_count = entity_count;
+    receiver->door_count = door_count;
+    if (receiver->latest == SNAPSHOT_NO_TICK || tick > receiver->latest) receiver->latest = tick;
+    return EX_TRUE;
+}
+
+static void snapshot_send_ack(EXTRANSPORT *transport, EXADDRESS address, uint32_t tick) {
+    uint8_t data[8];
+    SNAPSHOTBITS bits = {};
+    bits.data = data;
+    bits.capacity = sizeof(data);
+    snapshot_write(&bits, SNAPSHOT_PACKET_ACK, 8);
+    snapshot_write(&bits, tick, 32);
+    EXMU_transport_send(transport, address, data, bits.size);
+}
+
+EXBOOL snapshot_server_initialize(SNAPSHOTSERVER *server, EXTRANSPORT *transport, WORLD *world, int entity_count) {
+    if (entity_count > SNAPSHOT_MAX_ENTITIES) return EX_FALSE;
+    server->transport = transport;
+    server->world = world;
+    server->entity_count = entity_count;
+    server->position_bits = snapshot_position_bits(world);
+    server->tick = 0;
+    server->client_count = 0;
+    snapshot_empty(&server->current);
+    snapshot_empty(&server->empty);
+    return EX_TRUE;
+}
+
+// positions outside the map are clamped to its edge
+void snapshot_server_entity(SNAPSHOTSERVER *server, int index, EXBOOL active, EXFLOAT2 position, float angle) {
+    if (index < 0 || index >= server->entity_count) return;
+    SNAPSHOTENTITY *entity = server->current.entities + index;
+    int maximum = (1 << server->position_bits) - 1;
+    int x = (int)lroundf(position.x * SNAPSHOT_POSITION_SCALE);
+    int y = (int)lroundf(position.y * SNAPSHOT_POSITION_SCALE);
+    float turns = angle / (float)(2 * M_PI);
+    turns -= floorf(turns);
+    entity->active = active;
+    entity->x = active ? (x < 0 ? 0 : x > maximum ? maximum : x) : 0;
+    entity->y = active ? (y < 0 ? 0 : y > maximum ? maximum : y) : 0;
+    entity->angle = active ? (int)lroundf(turns * (1 << SNAPSHOT_ANGLE_BITS)) & ((1 << SNAPSHOT_ANGLE_BITS) - 1) : 0;
+}
+
+// any packet from an unknown address is taken as a new client
+void snapshot_server_receive(SNAPSHOTSERVER *server) {
+    uint8_t data[EX_MAX_PACKET_SIZE];
+    EXADDRESS address;
+    int size;
+    while ((size = EXMU_transport_receive(server->transport, &address, data, sizeof(data))) > 0) {
+        SNAPSHOTBITS bits = {};
+        bits.data = data;
+        bits.capacity = size;
+        if (snapshot_read(&bits, 8) != SNAPSHOT_PACKET_ACK) continue;
+        uint32_t tick = snapshot_read(&bits, 32);
+        if (bits.overflow) continue;
+
+        SNAPSHOTCLIENT *client = 0;
+        for (int index = 0; index < server->client_count; index++) {
+            SNAPSHOTCLIENT *candidate = server->clients + index;
+            if (candidate->address.host == address.host && candidate->address.port == address.port) client = candidate;
+        }
+        if (!client) {
+            if (server->client_count == SNAPSHOT_MAX_CLIENTS) continue;
+            client = server->clients + server->client_count++;
+            memset(client, 0, sizeof(SNAPSHOTCLIENT));
+            client->connected = EX_TRUE;
+            client->address = address;
+            client->acked = SNAPSHOT_NO_TICK;
+            for (int slot = 0; slot < SNAPSHOT_HISTORY; slot++) client->history[slot].tick = SNAPSHOT_NO_TICK;
+        }
+        if (tick == SNAPSHOT_NO_TICK || tick > server->tick) continue;
+        if (client->history[tick % SNAPSHOT_HISTORY].tick != tick) continue;
+        if (client->acked == SNAPSHOT_NO_TICK || tick > client->acked) client->acked = tick;
+    }
+}
+
+void snapshot_server_send(SNAPSHOTSERVER *server) {
+    EX_PROFILE_SCOPE("snapshot");
+    uint64_t begin = EXMU_profile_ticks();
+    WORLD *world = server->world;
+    server->tick += 1;
+    server->current.tick = server->tick;
+    for (int door = 0; door < world->door_count; door++) {
+        float opening = world->openings ? world->openings[world->doors[door].cell] : 0.0f;
+        server->current.doors[door] = (uint8_t)lroundf(opening * 255.0f);
+    }
+
+    uint8_t data[EX_MAX_PACKET_SIZE];
+    for (int index = 0; index < server->client_count; index++) {
+        SNAPSHOTCLIENT *client = server->clients + index;
+        SNAPSHOT *baseline = &server->empty;
+        if (client->acked != SNAPSHOT_NO_TICK && server->tick - client->acked < SNAPSHOT_HISTORY) {
+            baseline = client->history + (client->acked % SNAPSHOT_HISTORY);
+        }
+        // the baseline slot is never the one being written since acked is within the history window
+        SNAPSHOT *sent = client->history + (server->tick % SNAPSHOT_HISTORY);
+        int size = snapshot_encode(server, client, baseline, sent, data);
+        if (!size) {
+            sent->tick = SNAPSHOT_NO_TICK;
+            continue;
+        }
+        EXMU_transport_send(server->transport, client->address, data, size);
+        client->packets += 1;
+        client->bytes += size;
+        server->encoded_bytes += size;
+    }
+    server->encode_ticks += EXMU_profile_ticks() - begin;
+}
+
+EXBOOL snapshot_receiver_initialize(SNAPSHOTRECEIVER *receiver, EXTRANSPORT *transport, EXADDRESS server, WORLD *world, int entity_count) {
+    receiver->transport = transport;
+    receiver->server = server;
+    receiver->entity_count = entity_count;
+    receiver->door_count = 0;
+    receiver->position_bits = snapshot_position_bits(world);
+    receiver->latest = SNAPSHOT_NO_TICK;
+    for (int slot = 0; slot < SNAPSHOT_HISTORY; slot++) receiver->history[slot].tick = SNAPSHOT_NO_TICK;
+    snapshot_send_ack(transport, server, SNAPSHOT_NO_TICK);
+    return EX_TRUE;
+}
+
+// acks every snapshot it could decode, keeps saying hello until the first one arrives
+EXBOOL snapshot_receiver_update(SNAPSHOTRECEIVER *receiver) {
+    uint8_t data[EX_MAX_PACKET_SIZE];
+    EXADDRESS address;
+    int size;
+    uint32_t latest = receiver->latest;
+    while ((size = EXMU_transport_receive(receiver->transport, &address, data, sizeof(data))) > 0) {
+        uint32_t tick;
+        if (!snapshot_decode(receiver, data, size, &tick)) {
+            receiver->rejected += 1;
+            continue;
+        }
+        receiver->received += 1;
+        snapshot_send_ack(receiver->transport, receiver->server, tick);
+    }
+    if (receiver->latest == SNAPSHOT_NO_TICK) snapshot_send_ack(receiver->transport, receiver->server, SNAPSHOT_NO_TICK);
+    return receiver->latest != latest;
+}
+
+EXBOOL snapshot_receiver_entity(SNAPSHOTRECEIVER *receiver, int index, EXFLOAT2 *position, float *angle) {
+    if (receiver->latest == SNAPSHOT_NO_TICK || index < 0 || index >= receiver->entity_count) return EX_FALSE;
+    SNAPSHOT *snapshot = receiver->history + (receiver->latest % SNAPSHOT_HISTORY);
+    SNAPSHOTENTITY *entity = snapshot->entities + index;
+    if (snapshot->tick != receiver->latest || !entity->active) return EX_FALSE;
+    position->x = entity->x / SNAPSHOT_POSITION_SCALE;
+    position->y = entity->y / SNAPSHOT_POSITION_SCALE;
+    *angle = entity->angle * (float)(2 * M_PI) / (1 << SNAPSHOT_ANGLE_BITS);
+    return EX_TRUE;
+}
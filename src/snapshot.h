@@ -0,0 +1,79 @@
+#pragma once
+
+#include "exmu.h"
+#include "fov.h"
+#include "world.h"
+
+#define SNAPSHOT_MAX_ENTITIES 512
+#define SNAPSHOT_MAX_CLIENTS 8
+#define SNAPSHOT_HISTORY 32
+#define SNAPSHOT_NO_TICK 0xFFFFFFFFu
+#define SNAPSHOT_POSITION_SCALE 16.0f
+#define SNAPSHOT_ANGLE_BITS 10
+#define SNAPSHOT_SMALL_DELTA_BITS 7
+#define SNAPSHOT_INDEX_BITS 9
+#define SNAPSHOT_SMALL_GAP_BITS 3
+#define SNAPSHOT_PACKET_STATE 1
+#define SNAPSHOT_PACKET_ACK 2
+
+// positions in 1/SNAPSHOT_POSITION_SCALE world units, angle in 2^SNAPSHOT_ANGLE_BITS steps
+struct SNAPSHOTENTITY {
+    EXBOOL active;
+    int x;
+    int y;
+    int angle;
+};
+
+struct SNAPSHOT {
+    uint32_t tick;
+    SNAPSHOTENTITY entities[SNAPSHOT_MAX_ENTITIES];
+    uint8_t doors[WORLD_MAX_DOORS];
+};
+
+// history holds what was actually sent to this client, entities outside its visibility are
+// sent as inactive
+struct SNAPSHOTCLIENT {
+    EXBOOL connected;
+    EXADDRESS address;
+    uint32_t acked;
+    FOV *visibility;
+    uint64_t packets;
+    uint64_t bytes;
+    SNAPSHOT history[SNAPSHOT_HISTORY];
+};
+
+struct SNAPSHOTSERVER {
+    EXTRANSPORT *transport;
+    WORLD *world;
+    int entity_count;
+    int position_bits;
+    uint32_t tick;
+    SNAPSHOT current;
+    SNAPSHOT empty;
+    SNAPSHOTCLIENT clients[SNAPSHOT_MAX_CLIENTS];
+    int client_count;
+
+    uint64_t encode_ticks;
+    uint64_t encoded_bytes;
+};
+
+struct SNAPSHOTRECEIVER {
+    EXTRANSPORT *transport;
+    EXADDRESS server;
+    int entity_count;
+    int door_count;
+    int position_bits;
+    uint32_t latest;
+    SNAPSHOT history[SNAPSHOT_HISTORY];
+
+    uint64_t received;
+    uint64_t rejected;
+};
+
+EXBOOL snapshot_server_initialize(SNAPSHOTSERVER *server, EXTRANSPORT *transport, WORLD *world, int entity_count);
+void snapshot_server_entity(SNAPSHOTSERVER *server, int index, EXBOOL active, EXFLOAT2 position, float angle);
+void snapshot_server_receive(SNAPSHOTSERVER *server);
+void snapshot_server_send(SNAPSHOTSERVER *server);
+EXBOOL snapshot_receiver_initialize(SNAPSHOTRECEIVER *receiver, EXTRANSPORT *transport, EXADDRESS server, WORLD *world, int entity_count);
+EXBOOL snapshot_receiver_update(SNAPSHOTRECEIVER *receiver);
+EXBOOL snapshot_receiver_entity(SNAPSHOTRECEIVER *receiver, int index, EXFLOAT2 *position, float *angle);
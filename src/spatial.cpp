@@ -0,0 +1,145 @@
+#include "spatial.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int spatial_coordinate(SPATIALHASH *hash, float value) {
+    int coordinate = (int)floorf(value / hash->cell_size);
+    if (coordinate < 0) return 0;
+    if (coordinate >= hash->dimension) return hash->dimension - 1;
+    return coordinate;
+}
+
+EXBOOL spatial_initialize(SPATIALHASH *hash, float cell_size, int dimension, int capacity, EXARENA *arena) {
+    hash->cell_size = cell_size;
+    hash->dimension = dimension;
+    hash->capacity = capacity;
+    hash->count = 0;
+    hash->cell_starts = (int *)EXMU_arena_push(arena, (dimension * dimension + 1) * sizeof(int), 64);
+    hash->cells = (int *)EXMU_arena_push(arena, capacity * sizeof(int), 64);
+    hash->entries = (int *)EXMU_arena_push(arena, capacity * sizeof(int), 64);
+    hash->positions = (EXFLOAT2 *)EXMU_arena_push(arena, capacity * sizeof(EXFLOAT2), 64);
+    if (!hash->cell_starts || !hash->cells || !hash->entries || !hash->positions) {
+        hash->capacity = 0;
+        return EX_FALSE;
+    }
+    memset(hash->cell_starts, 0, (dimension * dimension + 1) * sizeof(int));
+    return EX_TRUE;
+}
+
+// the buffers go with the arena they came from
+void spatial_destroy(SPATIALHASH *hash) {
+    hash->capacity = 0;
+    hash->count = 0;
+    hash->cell_starts = 0;
+    hash->cells = 0;
+    hash->entries = 0;
+    hash->positions = 0;
+}
+
+// positions outside the grid are clamped into the border cells
+void spatial_rebuild(SPATIALHASH *hash, const EXFLOAT2 *positions, int count) {
+    if (count > hash->capacity) count = hash->capacity;
+    int cell_count = hash->dimension * hash->dimension;
+    int *starts = hash->cell_starts;
+    memset(starts, 0, (cell_count + 1) * sizeof(int));
+
+    // COUNT
+    for (int index = 0; index < count; index++) {
+        int cell = spatial_coordinate(hash, positions[index].x) + spatial_coordinate(hash, positions[index].y) * hash->dimension;
+        hash->cells[index] = cell;
+        starts[cell + 1] += 1;
+    }
+    for (int cell = 0; cell < cell_count; cell++) starts[cell + 1] += starts[cell];
+
+    // SCATTER
+    for (int index = 0; index < count; index++) {
+        int slot = starts[hash->cells[index]]++;
+        hash->entries[slot] = index;
+        hash->positions[slot] = positions[index];
+    }
+    for (int cell = cell_count; cell > 0; cell--) starts[cell] = starts[cell - 1];
+    starts[0] = 0;
+    hash->count = count;
+}
+
+int spatial_query_box(SPATIALHASH *hash, EXFLOAT2 min, EXFLOAT2 max, int *results, int max_results) {
+    int result_count = 0;
+    int min_x = spatial_coordinate(hash, min.x);
+    int min_y = spatial_coordinate(hash, min.y);
+    int max_x = spatial_coordinate(hash, max.x);
+    int max_y = spatial_coordinate(hash, max.y);
+    for (int y = min_y; y <= max_y; y++) {
+        int first = hash->cell_starts[min_x + y * hash->dimension];
+        int last = hash->cell_starts[max_x + y * hash->dimension + 1];
+        for (int slot = first; slot < last; slot++) {
+            EXFLOAT2 position = hash->positions[slot];
+            if (position.x < min.x || position.y < min.y || position.x > max.x || position.y > max.y) continue;
+            if (result_count == max_results) return result_count;
+            results[result_count++] = hash->entries[slot];
+        }
+    }
+    return result_count;
+}
+
+int spatial_query_radius(SPATIALHASH *hash, EXFLOAT2 center, float radius, int *results, int max_results) {
+    int result_count = 0;
+    float radius_squared = radius * radius;
+    int min_x = spatial_coordinate(hash, center.x - radius);
+    int min_y = spatial_coordinate(hash, center.y - radius);
+    int max_x = spatial_coordinate(hash, center.x + radius);
+    int max_y = spatial_coordinate(hash, center.y + radius);
+    for (int y = min_y; y <= max_y; y++) {
+        int first = hash->cell_starts[min_x + y * hash->dimension];
+        int last = hash->cell_starts[max_x + y * hash->dimension + 1];
+        for (int slot = first; slot < last; slot++) {
+            float dx = hash->positions[slot].x - center.x;
+            float dy = hash->positions[slot].y - center.y;
+            if (dx * dx + dy * dy > radius_squared) continue;
+            if (result_count == max_results) return result_count;
+            results[result_count++] = hash->entries[slot];
+        }
+    }
+    return result_count;
+}
+
+// each pair is reported once, a cell is only tested against itself and the neighbors after it
+void spatial_pairs(SPATIALHASH *hash, float radius, SPATIALPAIRPROC *proc, void *data) {
+    float radius_squared = radius * radius;
+    int reach = (int)ceilf(radius / hash->cell_size);
+    int dimension = hash->dimension;
+    for (int y = 0; y < dimension; y++) {
+        for (int x = 0; x < dimension; x++) {
+            int first = hash->cell_starts[x + y * dimension];
+            int last = hash->cell_starts[x + y * dimension + 1];
+            if (first == last) continue;
+            for (int slot = first; slot < last; slot++) {
+                EXFLOAT2 position = hash->positions[slot];
+
+                // SAME CELL
+                for (int other = slot + 1; other < last; other++) {
+                    float dx = hash->positions[other].x - position.x;
+                    float dy = hash->positions[other].y - position.y;
+                    if (dx * dx + dy * dy <= radius_squared) proc(data, hash->entries[slot], hash->entries[other]);
+                }
+
+                // FORWARD CELLS
+                for (int offset_y = 0; offset_y <= reach && y + offset_y < dimension; offset_y++) {
+                    int min_x = offset_y ? x - reach : x + 1;
+                    int max_x = x + reach;
+                    if (min_x < 0) min_x = 0;
+                    if (max_x >= dimension) max_x = dimension - 1;
+                    if (min_x > max_x) continue;
+                    int row = (y + offset_y) * dimension;
+                    int other_first = hash->cell_starts[min_x + row];
+                    int other_last = hash->cell_starts[max_x + row + 1];
+                    for (int other = other_first; other < other_last; other++) {
+                        float dx = hash->positions[other].x - position.x;
+                        float dy = hash->positions[other].y - position.y;
+                        if (dx * dx + dy * dy <= radius_squared) proc(data, hash->entries[slot], hash->entries[other]);
+                    }
+                }
+            }
+        }
+    }
+}
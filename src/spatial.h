@@ -0,0 +1,28 @@
+#pragma once
+
+#include "exmu.h"
+
+struct SPATIALHASH;
+
+typedef void SPATIALPAIRPROC(void *data, int a, int b);
+
+// entities are bucketed into square cells of cell_size with a counting sort, so after a rebuild
+// every cell's entities are contiguous in entries and positions
+struct SPATIALHASH {
+    float cell_size;
+    int dimension;
+    int capacity;
+    int count;
+
+    int *cell_starts;
+    int *cells;
+    int *entries;
+    EXFLOAT2 *positions;
+};
+
+EXBOOL spatial_initialize(SPATIALHASH *hash, float cell_size, int dimension, int capacity, EXARENA *arena);
+void spatial_destroy(SPATIALHASH *hash);
+void spatial_rebuild(SPATIALHASH *hash, const EXFLOAT2 *positions, int count);
+int spatial_query_box(SPATIALHASH *hash, EXFLOAT2 min, EXFLOAT2 max, int *results, int max_results);
+int spatial_query_radius(SPATIALHASH *hash, EXFLOAT2 center, float radius, int *results, int max_results);
+void spatial_pairs(SPATIALHASH *hash, float radius, SPATIALPAIRPROC *proc, void *data);
@@ -0,0 +1,126 @@
+#include "terrain.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t terrain_hash(uint32_t x, uint32_t y, uint32_t seed) {
+    uint32_t hash = x * 0x8DA6B343 ^ y * 0xD8163841 ^ seed * 0xCB1AB31F;
+    hash ^= hash >> 13;
+    hash *= 0x5BD1E995;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+// value noise with smoothstep interpolation, wrapping every period cells
+static float terrain_noise(int x, int y, int period, uint32_t seed) {
+    int cell_x = x / period;
+    int cell_y = y / period;
+    int cells = TERRAIN_SIZE / period;
+    float fx = (float)(x % period) / period;
+    float fy = (float)(y % period) / period;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fy = fy * fy * (3.0f - 2.0f * fy);
+    float a = (terrain_hash(cell_x % cells, cell_y % cells, seed) & 0xFFFF) / 65535.0f;
+    float b = (terrain_hash((cell_x + 1) % cells, cell_y % cells, seed) & 0xFFFF) / 65535.0f;
+    float c = (terrain_hash(cell_x % cells, (cell_y + 1) % cells, seed) & 0xFFFF) / 65535.0f;
+    float d = (terrain_hash((cell_x + 1) % cells, (cell_y + 1) % cells, seed) & 0xFFFF) / 65535.0f;
+    return (a + (b - a) * fx) + ((c + (d - c) * fx) - (a + (b - a) * fx)) * fy;
+}
+
+EXBOOL terrain_generate(TERRAIN *terrain, int size, uint32_t seed) {
+    if (size != TERRAIN_SIZE) return EX_FALSE;
+    free(terrain->heights);
+    free(terrain->colors);
+    terrain->heights = (uint8_t *)malloc(size * size);
+    terrain->colors = (uint8_t *)malloc(size * size);
+    if (!terrain->heights || !terrain->colors) return EX_FALSE;
+    terrain->size = size;
+
+    // HEIGHTS
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float height = 0.0f;
+            float amplitude = 0.5f;
+            for (int period = 128; period >= 8; period /= 2) {
+                height += terrain_noise(x, y, period, seed + period) * amplitude;
+                amplitude *= 0.5f;
+            }
+            terrain->heights[y * size + x] = (uint8_t)(height * 255.0f);
+        }
+    }
+
+    // COLORS
+    int mask = size - 1;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int height = terrain->heights[y * size + x];
+            int slope = height - terrain->heights[((y - 1) & mask) * size + ((x - 1) & mask)];
+            int shade = 20 + slope * 2;
+            if (shade < 4) shade = 4;
+            if (shade > RENDER_RAMP_SHADES - 1) shade = RENDER_RAMP_SHADES - 1;
+            int ramp = RENDER_RAMP_GRASS;
+            if (height < 70) ramp = RENDER_RAMP_SAND;
+            if (height > 170) ramp = RENDER_RAMP_GREY;
+            terrain->colors[y * size + x] = RENDER_RAMP(ramp, shade);
+        }
+    }
+    return EX_TRUE;
+}
+
+void terrain_destroy(TERRAIN *terrain) {
+    free(terrain->heights);
+    free(terrain->colors);
+    terrain->heights = 0;
+    terrain->colors = 0;
+    terrain->size = 0;
+}
+
+float terrain_height(TERRAIN *terrain, EXFLOAT2 position) {
+    int mask = terrain->size - 1;
+    int x = (int)floorf(position.x / TERRAIN_CELL_SIZE) & mask;
+    int y = (int)floorf(position.y / TERRAIN_CELL_SIZE) & mask;
+    return terrain->heights[y * terrain->size + x] * TERRAIN_HEIGHT_SCALE;
+}
+
+void terrain_render(TERRAIN *terrain, RAYCASTER *raycaster, RENDERER *renderer, EXFRAMEBUFFER *framebuffer,
+                    EXFLOAT2 position, float angle, float camera_height, int x) {
+    int height = framebuffer->height;
+    int columns = raycaster->columns;
+    if (x < 0 || x + columns > framebuffer->width) return;
+
+    int mask = terrain->size - 1;
+    float focal = (columns / 2) / tanf(raycaster->fov / 2);
+    float horizon = height / 2.0f;
+    float cell_scale = 1.0f / TERRAIN_CELL_SIZE;
+    float band_scale = RENDER_DISTANCE_BANDS / TERRAIN_MAX_DISTANCE;
+    int center = (int)floorf(angle / raycaster->angle_step + 0.5f);
+    for (int column = 0; column < columns; column++) {
+        float ray_angle = (center - columns / 2 + column) * raycaster->angle_step;
+        float direction_x = cosf(ray_angle) * cell_scale;
+        float direction_y = sinf(ray_angle) * cell_scale;
+        float projection = focal / raycaster->column_cosines[column];
+        float origin_x = position.x * cell_scale;
+        float origin_y = position.y * cell_scale;
+        uint8_t *pixels = framebuffer->indices + (x + column) * height;
+
+        // front to back, so everything above the y-buffer is still uncovered
+        int y_buffer = height;
+        float step = TERRAIN_NEAR_STEP;
+        for (float distance = TERRAIN_NEAR_STEP; distance < TERRAIN_MAX_DISTANCE && y_buffer > 0; distance += step) {
+            int cell_x = (int)floorf(origin_x + direction_x * distance) & mask;
+            int cell_y = (int)floorf(origin_y + direction_y * distance) & mask;
+            int cell = cell_y * terrain->size + cell_x;
+            float sample_height = terrain->heights[cell] * TERRAIN_HEIGHT_SCALE;
+            int top = (int)((camera_height - sample_height) * projection / distance + horizon);
+            if (top < 0) top = 0;
+            if (top < y_buffer) {
+                int band = (int)(distance * band_scale);
+                uint8_t color = renderer->colormaps[RENDER_LIGHT_LEVELS - 1][band][terrain->colors[cell]];
+                memset(pixels + top, color, y_buffer - top);
+                y_buffer = top;
+            }
+            step *= TERRAIN_STEP_GROWTH;
+            terrain->samples += 1;
+        }
+        if (y_buffer > 0) memset(pixels, TERRAIN_SKY_COLOR, y_buffer);
+    }
+}
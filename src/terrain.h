@@ -0,0 +1,28 @@
+#pragma once
+
+#include "exmu.h"
+#include "raycast.h"
+#include "render.h"
+
+#define TERRAIN_SIZE 512
+#define TERRAIN_CELL_SIZE 8.0f
+#define TERRAIN_HEIGHT_SCALE 3.0f
+#define TERRAIN_EYE_HEIGHT 24.0f
+#define TERRAIN_MAX_DISTANCE 3000.0f
+#define TERRAIN_NEAR_STEP 2.0f
+#define TERRAIN_STEP_GROWTH 1.015f
+#define TERRAIN_SKY_COLOR RENDER_RAMP(RENDER_RAMP_SKY, 24)
+
+struct TERRAIN {
+    int size;
+    uint8_t *heights;
+    uint8_t *colors;
+
+    uint64_t samples;
+};
+
+EXBOOL terrain_generate(TERRAIN *terrain, int size, uint32_t seed);
+void terrain_destroy(TERRAIN *terrain);
+float terrain_height(TERRAIN *terrain, EXFLOAT2 position);
+void terrain_render(TERRAIN *terrain, RAYCASTER *raycaster, RENDERER *renderer, EXFRAMEBUFFER *framebuffer,
+                    EXFLOAT2 position, float angle, float camera_height, int x);
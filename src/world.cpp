@@ -0,0 +1,143 @@
+#include "world.h"
+#include <stdlib.h>
+#include <string.h>
+
+// returns whether the cell started or stopped blocking movement
+static EXBOOL world_update_solid(WORLD *world, int index) {
+    if (!world->solid) return EX_FALSE;
+    int x = index % world->dimension;
+    int y = index / world->dimension;
+    uint64_t *word = world->solid + y * world->solid_stride + x / 64;
+    uint64_t bit = (uint64_t)1 << (x % 64);
+    EXBOOL solid = world->map[index] != WORLD_EMPTY;
+    if (world->map[index] == WORLD_DOOR && world->openings && world->openings[index] >= WORLD_DOOR_PASSABLE) solid = EX_FALSE;
+    EXBOOL was_solid = (*word & bit) != 0;
+    if (solid) *word |= bit;
+    else *word &= ~bit;
+    return solid != was_solid;
+}
+
+// the buffers belong to the arena, so a world is initialized once per arena
+EXBOOL world_initialize(WORLD *world, EXARENA *arena) {
+    int count = world->dimension * world->dimension;
+    world->solid_stride = (world->dimension + 63) / 64;
+    size_t solid_size = (size_t)world->solid_stride * world->dimension * sizeof(uint64_t);
+    world->openings = (float *)EXMU_arena_push(arena, count * sizeof(float), 64);
+    world->solid = (uint64_t *)EXMU_arena_push(arena, solid_size, 64);
+    if (!world->openings || !world->solid) return EX_FALSE;
+    memset(world->openings, 0, count * sizeof(float));
+    memset(world->solid, 0, solid_size);
+    world->door_count = 0;
+    for (int index = 0; index < count; index++) {
+        world_update_solid(world, index);
+        if (world->map[index] == WORLD_DOOR && world->door_count < WORLD_MAX_DOORS) {
+            world->doors[world->door_count].cell = index;
+            world->doors[world->door_count].target = 0.0f;
+            world->door_count += 1;
+        }
+    }
+    world->revision += 1;
+    world->solid_revision += 1;
+    return EX_TRUE;
+}
+
+// the memory goes with the arena, this drops what points into it so the world is not used after
+void world_destroy(WORLD *world) {
+    world->openings = 0;
+    world->solid = 0;
+    world->door_count = 0;
+    world->listener_count = 0;
+}
+
+WORLDCELL world_cell(WORLD *world, int index) {
+    WORLDCELL cell;
+    if (world->cells && world->heights) {
+        cell = world->cells[index];
+    } else {
+        cell.floor = world->map[index] ? world->tile_size : 0;
+        cell.ceiling = world->tile_size;
+    }
+    if (world->map[index] == WORLD_DOOR) {
+        float opening = world->openings ? world->openings[index] : 0.0f;
+        cell.floor = (int16_t)(world->tile_size * (1.0f - opening));
+    }
+    return cell;
+}
+
+EXBOOL world_solid(WORLD *world, int x, int y) {
+    if (x < 0 || y < 0 || x >= world->dimension || y >= world->dimension) return EX_TRUE;
+    if (!world->solid) return world->map[x + y * world->dimension] != WORLD_EMPTY;
+    return (world->solid[y * world->solid_stride + x / 64] >> (x % 64)) & 1;
+}
+
+EXBOOL world_listen(WORLD *world, WORLDLISTENER *listener, void *data) {
+    if (world->listener_count >= WORLD_MAX_LISTENERS) return EX_FALSE;
+    world->listeners[world->listener_count] = listener;
+    world->listener_data[world->listener_count] = data;
+    world->listener_count += 1;
+    return EX_TRUE;
+}
+
+void world_dirty(WORLD *world, int x, int y, int width, int height, int changes) {
+    world->revision += 1;
+    if (changes & WORLD_CHANGED_SOLID) world->solid_revision += 1;
+    for (int index = 0; index < world->listener_count; index++) {
+        world->listeners[index](world->listener_data[index], world, x, y, width, height, changes);
+    }
+}
+
+void world_set_cell(WORLD *world, int x, int y, int value) {
+    if (x < 0 || y < 0 || x >= world->dimension || y >= world->dimension) return;
+    int index = x + y * world->dimension;
+    if (world->map[index] == value) return;
+
+    if (world->map[index] == WORLD_DOOR) {
+        for (int door = 0; door < world->door_count; door++) {
+            if (world->doors[door].cell != index) continue;
+            world->doors[door] = world->doors[--world->door_count];
+            break;
+        }
+    }
+    if (value == WORLD_DOOR) {
+        if (world->door_count >= WORLD_MAX_DOORS) return;
+        world->doors[world->door_count].cell = index;
+        world->doors[world->door_count].target = 0.0f;
+        world->door_count += 1;
+    }
+
+    world->map[index] = value;
+    if (world->cells) {
+        world->cells[index].floor = value ? world->tile_size : 0;
+        world->cells[index].ceiling = world->tile_size;
+    }
+    if (world->openings) world->openings[index] = 0.0f;
+    int changes = WORLD_CHANGED_SHAPE;
+    if (world_update_solid(world, index)) changes |= WORLD_CHANGED_SOLID;
+    world_dirty(world, x, y, 1, 1, changes);
+}
+
+void world_door(WORLD *world, int x, int y, EXBOOL open) {
+    int index = x + y * world->dimension;
+    for (int door = 0; door < world->door_count; door++) {
+        if (world->doors[door].cell == index) world->doors[door].target = open ? 1.0f : 0.0f;
+    }
+}
+
+void world_update(WORLD *world, float delta_seconds) {
+    if (!world->openings) return;
+    for (int door = 0; door < world->door_count; door++) {
+        int index = world->doors[door].cell;
+        float opening = world->openings[index];
+        float target = world->doors[door].target;
+        if (opening == target) continue;
+
+        float step = WORLD_DOOR_SPEED * delta_seconds;
+        if (opening < target) opening = opening + step < target ? opening + step : target;
+        else opening = opening - step > target ? opening - step : target;
+        // a moving door only changes what the raycaster sees until it crosses WORLD_DOOR_PASSABLE
+        world->openings[index] = opening;
+        int changes = WORLD_CHANGED_SHAPE;
+        if (world_update_solid(world, index)) changes |= WORLD_CHANGED_SOLID;
+        world_dirty(world, index % world->dimension, index / world->dimension, 1, 1, changes);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "exmu.h"
+
+#define WORLD_EMPTY 0
+#define WORLD_WALL 1
+#define WORLD_DOOR 2
+#define WORLD_MAX_LISTENERS 8
+#define WORLD_MAX_DOORS 64
+#define WORLD_DOOR_SPEED 1.5f
+#define WORLD_DOOR_PASSABLE 0.9f
+#define WORLD_CHANGED_SHAPE 1
+#define WORLD_CHANGED_SOLID 2
+
+struct WORLD;
+
+// called after every edit with the dirty rectangle in cells and the WORLD_CHANGED bits for what
+// changed inside it, revisions already bumped
+typedef void WORLDLISTENER(void *data, WORLD *world, int x, int y, int width, int height, int changes);
+
+// floor is the top of the block rising from the ground, ceiling the bottom of the block hanging
+// down from tile_size; a full wall has its floor at tile_size
+struct WORLDCELL {
+    int16_t floor;
+    int16_t ceiling;
+};
+
+struct WORLDDOOR {
+    int cell;
+    float target;
+};
+
+struct WORLD {
+    int dimension;
+    int tile_size;
+    int *map;
+    // revision counts every edit, solid_revision only those that changed which cells block movement
+    uint32_t revision;
+    uint32_t solid_revision;
+    // cells are kept in step with map edits even while heights is off and the world is drawn flat
+    WORLDCELL *cells;
+    EXBOOL heights;
+
+    float *openings;
+    uint64_t *solid;
+    int solid_stride;
+
+    WORLDDOOR doors[WORLD_MAX_DOORS];
+    int door_count;
+
+    WORLDLISTENER *listeners[WORLD_MAX_LISTENERS];
+    void *listener_data[WORLD_MAX_LISTENERS];
+    int listener_count;
+};
+
+EXBOOL world_initialize(WORLD *world, EXARENA *arena);
+void world_destroy(WORLD *world);
+WORLDCELL world_cell(WORLD *world, int index);
+EXBOOL world_solid(WORLD *world, int x, int y);
+EXBOOL world_listen(WORLD *world, WORLDLISTENER *listener, void *data);
+void world_dirty(WORLD *world, int x, int y, int width, int height, int changes);
+void world_set_cell(WORLD *world, int x, int y, int value);
+void world_door(WORLD *world, int x, int y, EXBOOL open);
+void world_update(WORLD *world, float delta_seconds);